@@ -1,98 +1,202 @@
 #ifndef CYX_BUILDIN_HPP
 #define CYX_BUILDIN_HPP
 
+#include "input.h"
+#include "output.h"
 #include "value.hpp"
 
-#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <iterator>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <vector>
 
-static CYX::Value *buildin_print(CYX::Value *arg)
+// args: [args, args + argc), the result goes to `ret`, which is empty on entry.
+// argc is checked against the arity of the builtin by the compiler
+using BuildinFunc = void (*)(CYX::Value *args, int argc, CYX::Value &ret);
+
+// max_argc of a builtin taking any number of arguments
+inline constexpr int VARIADIC = -1;
+
+struct Buildin
+{
+    std::string_view name;
+    BuildinFunc func;
+    int min_argc;
+    int max_argc;               // VARIADIC if unbounded
+    bool converts_arg{ false }; // `int(a)` as a statement converts `a` itself, the result is stored back to it
+};
+
+inline void buildin_print(CYX::Value *args, int argc, CYX::Value &ret)
+{
+    for (int i = 0; i < argc; i++)
+    {
+        CYX::output().write(args[i]);
+    }
+}
+
+inline void buildin_println(CYX::Value *args, int argc, CYX::Value &ret)
 {
-    std::cout << arg->as<std::string>();
-    return nullptr;
+    buildin_print(args, argc, ret);
+    CYX::output().newline();
 }
 
-static CYX::Value *buildin_println(CYX::Value *arg)
+inline void buildin_flush(CYX::Value *args, int argc, CYX::Value &ret)
 {
-    std::cout << arg->as<std::string>() << std::endl;
-    return nullptr;
+    CYX::output().flush();
 }
 
-static CYX::Value *buildin_read(CYX::Value *target)
+// base ** exp % mod in [0, mod), the products are taken in 128 bits so any int modulus works
+inline void buildin_powmod(CYX::Value *args, int argc, CYX::Value &ret)
 {
-    std::string input;
-    std::cin >> input;
-    return new CYX::Value(input);
+    const auto base = args[0].as<long long>();
+    auto exp        = args[1].as<long long>();
+    const auto mod  = args[2].as<long long>();
+    if (mod <= 0 || exp < 0) CERR("powmod() takes a non-negative exponent and a positive modulus");
+    using Wide    = unsigned __int128;
+    const Wide m  = mod;
+    Wide factor   = (base % mod + static_cast<__int128>(mod)) % mod;
+    Wide result   = 1 % m;
+    for (; exp > 0; exp >>= 1)
+    {
+        if (exp & 1) result = result * factor % m;
+        factor = factor * factor % m;
+    }
+    ret = static_cast<long long>(result);
 }
 
-static CYX::Value *buildin_int(CYX::Value *target)
+// next token as a string
+inline void buildin_read(CYX::Value *args, int argc, CYX::Value &ret)
 {
-    *target = target->as<long long>();
-    return nullptr;
+    ret = std::string(CYX::input().token());
 }
 
-static CYX::Value *buildin_double(CYX::Value *target)
+inline void buildin_readInt(CYX::Value *args, int argc, CYX::Value &ret)
 {
-    *target = target->as<double>();
-    return nullptr;
+    ret = CYX::input().readInt();
 }
 
-static CYX::Value *buildin_string(CYX::Value *target)
+inline void buildin_readDouble(CYX::Value *args, int argc, CYX::Value &ret)
 {
-    *target = target->as<std::string>();
-    return nullptr;
+    ret = CYX::input().readDouble();
 }
 
-static CYX::Value *buildin_len(CYX::Value *target)
+inline void buildin_readLine(CYX::Value *args, int argc, CYX::Value &ret)
 {
-    long long size = 0;
-    if (target != nullptr)
+    ret = std::string(CYX::input().readLine());
+}
+
+inline void buildin_readAll(CYX::Value *args, int argc, CYX::Value &ret)
+{
+    ret = std::string(CYX::input().readAll());
+}
+
+// array of the next n int tokens
+inline void buildin_readInts(CYX::Value *args, int argc, CYX::Value &ret)
+{
+    const auto n = args[0].as<long long>();
+    std::vector<CYX::Value> arr;
+    arr.reserve(std::max(n, 0LL));
+    for (long long i = 0; i < n; i++)
     {
-        if (target->is<std::string>())
-            size = target->as<std::string>().size();
-        else if (target->isArray())
-            size = target->asArray()->size();
-        else
-            UNREACHABLE();
+        arr.emplace_back(CYX::input().readInt());
     }
-    return new CYX::Value(size);
+    ret = std::move(arr);
 }
 
-#define BUILDIN_NAME(IDX, X)                                                                                           \
-    {                                                                                                                  \
-        #X,                                                                                                            \
-        {                                                                                                              \
-            &X, IDX                                                                                                    \
-        }                                                                                                              \
-    }
+inline void buildin_int(CYX::Value *args, int argc, CYX::Value &ret)
+{
+    ret = args[0].as<long long>();
+}
 
-#define BUILDIN_IDX(IDX, X)                                                                                            \
-    {                                                                                                                  \
-        IDX, &X                                                                                                        \
-    }
+inline void buildin_double(CYX::Value *args, int argc, CYX::Value &ret)
+{
+    ret = args[0].as<double>();
+}
 
-static const std::unordered_map<std::string, std::pair<CYX::Value *(*) (CYX::Value *), int>> buildin_functions = {
-    BUILDIN_NAME(1, buildin_print),   //
-    BUILDIN_NAME(2, buildin_println), //
-    BUILDIN_NAME(3, buildin_read),    //
-    BUILDIN_NAME(4, buildin_int),     //
-    BUILDIN_NAME(5, buildin_double),  //
-    BUILDIN_NAME(6, buildin_string),  //
-    BUILDIN_NAME(7, buildin_len),     //
-};
+inline void buildin_string(CYX::Value *args, int argc, CYX::Value &ret)
+{
+    ret = args[0].as<std::string>();
+}
+
+inline void buildin_len(CYX::Value *args, int argc, CYX::Value &ret)
+{
+    const auto &target = args[0];
+    if (target.is<std::string>())
+        ret = static_cast<long long>(target.asStr()->size());
+    else if (target.isArray())
+        ret = static_cast<long long>(target.asArray()->size());
+    else
+        UNREACHABLE();
+}
 
-static const std::unordered_map<int, CYX::Value *(*) (CYX::Value *)> buildin_functions_index = {
-    BUILDIN_IDX(1, buildin_print),   //
-    BUILDIN_IDX(2, buildin_println), //
-    BUILDIN_IDX(3, buildin_read),    //
-    BUILDIN_IDX(4, buildin_int),     //
-    BUILDIN_IDX(5, buildin_double),  //
-    BUILDIN_IDX(6, buildin_string),  //
-    BUILDIN_IDX(7, buildin_len),     //
+// a builtin is called by the index in this table, CALL target is -index. index 0 is reserved for "no builtin"
+inline constexpr Buildin core_buildins[] = {
+    { "", nullptr, 0, 0 },                        //
+    { "print", &buildin_print, 0, VARIADIC },     //
+    { "println", &buildin_println, 0, VARIADIC }, //
+    { "read", &buildin_read, 0, 0 },              //
+    { "int", &buildin_int, 1, 1, true },          //
+    { "double", &buildin_double, 1, 1, true },    //
+    { "string", &buildin_string, 1, 1, true },    //
+    { "len", &buildin_len, 1, 1 },                //
+    { "flush", &buildin_flush, 0, 0 },            //
+    { "readInt", &buildin_readInt, 0, 0 },        //
+    { "readDouble", &buildin_readDouble, 0, 0 },  //
+    { "readLine", &buildin_readLine, 0, 0 },      //
+    { "readAll", &buildin_readAll, 0, 0 },        //
+    { "readInts", &buildin_readInts, 1, 1 },      //
+    { "powmod", &buildin_powmod, 3, 3 },          //
 };
 
-#undef BUILDIN_IDX
-#undef BUILDIN_NAME
+namespace detail
+{
+    // core builtins followed by the ones registered by the embedder
+    inline std::vector<Buildin> &buildinStorage()
+    {
+        static std::vector<Buildin> table(std::begin(core_buildins), std::end(core_buildins));
+        return table;
+    }
+    inline std::atomic<bool> &buildinsFrozen()
+    {
+        static std::atomic<bool> frozen{ false };
+        return frozen;
+    }
+    inline int findIn(const std::vector<Buildin> &table, std::string_view name)
+    {
+        for (int i = 1; i < table.size(); i++)
+        {
+            if (table[i].name == name) return i;
+        }
+        return 0;
+    }
+} // namespace detail
+
+// the first read freezes the table, it never changes while the compiler or the VM(on any thread) looks into it
+inline const std::vector<Buildin> &buildinTable()
+{
+    auto &frozen = detail::buildinsFrozen();
+    if (!frozen.load(std::memory_order_acquire)) frozen.store(true, std::memory_order_release);
+    return detail::buildinStorage();
+}
+
+// index of the builtin called `name`, 0 if there is none
+inline int findBuildin(std::string_view name)
+{
+    return detail::findIn(buildinTable(), name);
+}
+
+// make a native function callable from cyx code, before anything is compiled or run(the table is frozen then).
+// `name` must outlive the table(a string literal usually), bytecode calling it needs the same registrations
+inline int registerBuildin(std::string_view name, BuildinFunc func, int min_argc, int max_argc = VARIADIC)
+{
+    if (detail::buildinsFrozen().load(std::memory_order_acquire))
+        CERR("builtin `" + std::string(name) + "` is registered after the builtins were used");
+    auto &table = detail::buildinStorage();
+    if (detail::findIn(table, name) != 0) CERR("builtin `" + std::string(name) + "` is registered already");
+    table.push_back(Buildin{ name, func, min_argc, max_argc });
+    return static_cast<int>(table.size()) - 1;
+}
 
 #endif // CYX_BUILDIN_H
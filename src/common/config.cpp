@@ -1,18 +1,12 @@
 #include "config.h"
 
 const std::string ENTRY_FUNC = "main";
-bool NO_SSA                  = true;
-bool NO_CODE_SIMPLIFY        = false;
-bool NO_CFG_SIMPLIFY         = false;
-bool CONSTANT_FOLDING        = false;
-bool CONSTANT_PROPAGATION    = false;
-bool REMOVE_UNUSED_DEFINE    = false;
-bool DEAD_CODE_ELIMINATION   = false;
-bool PEEPHOLE                = false;
 //
-const int STATE_REGISTER = 0;
-// debug output
-bool DUMP_AST_STR     = false;
-bool DUMP_CFG_STR     = false;
-bool DUMP_IR_STR      = false;
-bool DUMP_VM_INST_STR = false;
\ No newline at end of file
+const int STATE_REGISTER         = 0;
+const int DEFAULT_MAX_CALL_DEPTH = 1 << 16;
+const int MAX_QUICKEN_MISSES     = 4;    // a site stays generic after this many type misses
+const int JIT_THRESHOLD          = 1000; // calls and loop iterations before a function is compiled
+const int JIT_MAX_DEPTH          = 1024; // nested native calls, deeper ones are interpreted to bound the C++ stack
+const int TIER_THRESHOLD         = 200;  // calls and loop iterations before a function is recompiled with optimization
+const int OUTPUT_BLOCK_SIZE      = 1 << 16;
+const int INPUT_BLOCK_SIZE       = 1 << 16;
@@ -4,20 +4,43 @@
 #include <string>
 
 extern const std::string ENTRY_FUNC;
-extern bool NO_SSA;
-extern bool NO_CODE_SIMPLIFY;
-extern bool NO_CFG_SIMPLIFY;
-extern bool CONSTANT_FOLDING;
-extern bool CONSTANT_PROPAGATION;
-extern bool REMOVE_UNUSED_DEFINE;
-extern bool DEAD_CODE_ELIMINATION;
-extern bool PEEPHOLE;
 //
 extern const int STATE_REGISTER;
-// debug output
-extern bool DUMP_AST_STR;
-extern bool DUMP_CFG_STR;
-extern bool DUMP_IR_STR;
-extern bool DUMP_VM_INST_STR;
+extern const int DEFAULT_MAX_CALL_DEPTH;
+extern const int MAX_QUICKEN_MISSES;
+extern const int JIT_THRESHOLD;
+extern const int JIT_MAX_DEPTH;
+extern const int TIER_THRESHOLD;
+extern const int OUTPUT_BLOCK_SIZE;
+extern const int INPUT_BLOCK_SIZE;
+
+// where SSA construction places phis
+enum class SSAForm
+{
+    PRUNED,      // only where the variable is live(liveness analysis)
+    SEMI_PRUNED, // only for variables read in another block than the one defining them, no dataflow
+    MINIMAL,     // at every join of two definitions
+};
+
+// what one program is compiled and run with, every compilation owns a copy so several can run at once
+struct CompileOptions
+{
+    bool no_ssa{ true };
+    SSAForm ssa_form{ SSAForm::PRUNED };
+    bool no_code_simplify{ false };
+    bool no_cfg_simplify{ false };
+    bool constant_folding{ false };
+    bool constant_propagation{ false };
+    bool global_value_numbering{ false };
+    bool remove_unused_define{ false };
+    bool dead_code_elimination{ false };
+    bool peephole{ false };
+    bool no_superinstruction{ false };
+    bool no_register_allocation{ false };
+    bool no_jit{ false };
+    bool tiered{ false };
+    bool no_tail_call{ false };
+    int compile_threads{ 0 }; // functions transformed to SSA at once, 0 is one per core
+};
 
 #endif // CVM_CONFIG_H
@@ -0,0 +1,145 @@
+#include "input.h"
+#include "config.h"
+#include "output.h"
+#include "value.hpp"
+
+#include <cctype>
+#include <cstring>
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+// what is available, a terminal gives one line at a time
+static long readStdin(char *dst, size_t size)
+{
+#ifdef _WIN32
+    return _read(0, dst, static_cast<unsigned>(size));
+#else
+    return read(STDIN_FILENO, dst, size);
+#endif
+}
+
+static thread_local CYX::Input *bound = nullptr;
+
+CYX::Input::Input() : buffer(INPUT_BLOCK_SIZE)
+{
+}
+
+CYX::Input::Input(std::string_view data) : buffer(data.begin(), data.end()), end(data.size()), eof(true)
+{
+}
+
+bool CYX::Input::fill()
+{
+    if (eof) return false;
+    // the output asked for the input is shown first
+    output().beforeRead();
+    if (pos > 0)
+    {
+        std::memmove(buffer.data(), buffer.data() + pos, end - pos);
+        end -= pos;
+        pos = 0;
+    }
+    if (end == buffer.size()) buffer.resize(buffer.size() * 2);
+    const long n = readStdin(buffer.data() + end, buffer.size() - end);
+    if (n <= 0)
+    {
+        eof = true;
+        return false;
+    }
+    end += n;
+    return true;
+}
+
+bool CYX::Input::skipSpace()
+{
+    while (true)
+    {
+        while (pos < end && std::isspace(static_cast<unsigned char>(buffer[pos])))
+        {
+            pos++;
+        }
+        if (pos < end) return true;
+        if (!fill()) return false;
+    }
+}
+
+std::string_view CYX::Input::token()
+{
+    if (!skipSpace()) return {};
+    size_t i = pos;
+    while (true)
+    {
+        while (i < end && !std::isspace(static_cast<unsigned char>(buffer[i])))
+        {
+            i++;
+        }
+        if (i < end) break;
+        // fill() moves the token to the front
+        const size_t len = i - pos;
+        const bool more  = fill();
+        i                = pos + len;
+        if (!more) break;
+    }
+    std::string_view str(buffer.data() + pos, i - pos);
+    pos = i;
+    return str;
+}
+
+long long CYX::Input::readInt()
+{
+    return parseNumber<long long>(token());
+}
+
+double CYX::Input::readDouble()
+{
+    return parseNumber<double>(token());
+}
+
+std::string_view CYX::Input::readLine()
+{
+    size_t i = pos;
+    while (true)
+    {
+        const void *nl = std::memchr(buffer.data() + i, '\n', end - i);
+        if (nl != nullptr)
+        {
+            i = static_cast<const char *>(nl) - buffer.data();
+            break;
+        }
+        const size_t len = end - pos;
+        const bool more  = fill();
+        i                = pos + len;
+        if (!more) break;
+    }
+    std::string_view line(buffer.data() + pos, i - pos);
+    pos = i < end ? i + 1 : i;
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    return line;
+}
+
+std::string_view CYX::Input::readAll()
+{
+    while (fill())
+    {
+    }
+    std::string_view rest(buffer.data() + pos, end - pos);
+    pos = end;
+    return rest;
+}
+
+CYX::Input &CYX::input()
+{
+    if (bound != nullptr) return *bound;
+    static Input in;
+    return in;
+}
+
+CYX::Input *CYX::bindInput(CYX::Input *in)
+{
+    auto *prev = bound;
+    bound      = in;
+    return prev;
+}
@@ -0,0 +1,45 @@
+#ifndef CYX_INPUT_H
+#define CYX_INPUT_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace CYX
+{
+    // stdin of the running program, read in blocks and parsed right from the buffer.
+    // a token is a run of non-whitespace characters, a malformed or missing number reads as 0
+    class Input
+    {
+      public:
+        Input();
+        // the whole input given upfront
+        explicit Input(std::string_view data);
+        Input(const Input &)            = delete;
+        Input &operator=(const Input &) = delete;
+        std::string_view token();
+        long long readInt();
+        double readDouble();
+        // without the line break
+        std::string_view readLine();
+        std::string_view readAll();
+
+      private:
+        // read more input after [pos, end), false at the end of the input
+        bool fill();
+        bool skipSpace();
+
+      private:
+        std::vector<char> buffer;
+        size_t pos{ 0 };
+        size_t end{ 0 };
+        bool eof{ false };
+    };
+
+    // the input bound to this thread, the process stdin if there is none
+    Input &input();
+    // returns the previous one, nullptr unbinds
+    Input *bindInput(Input *in);
+} // namespace CYX
+
+#endif // CYX_INPUT_H
@@ -0,0 +1,86 @@
+#include "output.h"
+
+#include <charconv>
+
+static thread_local CYX::Output *bound = nullptr;
+
+CYX::Output::Output(std::ostream &out) : out(&out)
+{
+    buffer.reserve(OUTPUT_BLOCK_SIZE);
+}
+
+CYX::Output::~Output()
+{
+    flush();
+}
+
+void CYX::Output::setPolicy(CYX::FlushPolicy policy)
+{
+    this->policy = policy;
+    if (policy == FlushPolicy::LINE) flush();
+}
+
+// ints and doubles are formatted right into the buffer, with the digits of std::to_string
+void CYX::Output::write(const CYX::Value &value)
+{
+    char chars[64];
+    if (value.is<long long>())
+    {
+        const auto res = std::to_chars(chars, chars + sizeof(chars), value.value<long long>());
+        write(std::string_view(chars, res.ptr - chars));
+        return;
+    }
+    if (value.is<double>())
+    {
+        const auto res =
+            std::to_chars(chars, chars + sizeof(chars), value.value<double>(), std::chars_format::fixed, 6);
+        if (res.ec == std::errc())
+        {
+            write(std::string_view(chars, res.ptr - chars));
+            return;
+        }
+    }
+    if (const auto *str = value.asStr(); str != nullptr)
+        write(*str);
+    else
+        write(value.as<std::string>());
+}
+
+void CYX::Output::write(std::string_view str)
+{
+    if (policy != FlushPolicy::EXIT && buffer.size() + str.size() > OUTPUT_BLOCK_SIZE) flush();
+    buffer.append(str);
+}
+
+void CYX::Output::newline()
+{
+    buffer.push_back('\n');
+    if (policy == FlushPolicy::LINE) flush();
+}
+
+void CYX::Output::beforeRead()
+{
+    if (policy != FlushPolicy::EXIT) flush();
+}
+
+void CYX::Output::flush()
+{
+    if (buffer.empty()) return;
+    out->write(buffer.data(), buffer.size());
+    out->flush();
+    buffer.clear();
+}
+
+CYX::Output &CYX::output()
+{
+    if (bound != nullptr) return *bound;
+    static Output out;
+    return out;
+}
+
+CYX::Output *CYX::bindOutput(CYX::Output *out)
+{
+    auto *prev = bound;
+    bound      = out;
+    return prev;
+}
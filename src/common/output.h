@@ -0,0 +1,49 @@
+#ifndef CYX_OUTPUT_H
+#define CYX_OUTPUT_H
+
+#include "config.h"
+#include "value.hpp"
+
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace CYX
+{
+    enum class FlushPolicy
+    {
+        LINE,  // every println
+        BLOCK, // every OUTPUT_BLOCK_SIZE bytes
+        EXIT   // only by flush() and at exit
+    };
+
+    // stdout of the running program. print/println format into the buffer, which is written out according to the
+    // policy, before reading input(except for EXIT) and when it is destroyed.
+    class Output
+    {
+      public:
+        explicit Output(std::ostream &out = std::cout);
+        Output(const Output &)            = delete;
+        Output &operator=(const Output &) = delete;
+        ~Output();
+        void setPolicy(FlushPolicy policy);
+        void write(const Value &value);
+        void write(std::string_view str);
+        void newline();
+        // the program is about to wait for input
+        void beforeRead();
+        void flush();
+
+      private:
+        std::ostream *out;
+        std::string buffer;
+        FlushPolicy policy{ FlushPolicy::BLOCK };
+    };
+
+    // the output bound to this thread, the process stdout(flushed at exit, CERR included) if there is none
+    Output &output();
+    // returns the previous one, nullptr unbinds
+    Output *bindOutput(Output *out);
+} // namespace CYX
+
+#endif // CYX_OUTPUT_H
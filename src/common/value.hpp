@@ -3,45 +3,133 @@
 
 #include "../utility/log.h"
 
-#include <list>
+#include <cctype>
+#include <charconv>
+#include <cmath>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <utility>
-#include <variant>
+#include <vector>
 
 namespace CYX
 {
+    class Value;
+
+    // like std::stoll/std::stod without exceptions: leading spaces and '+' are skipped, 0 if there is no number
+    template<typename T>
+    T parseNumber(std::string_view str)
+    {
+        while (!str.empty() && std::isspace(static_cast<unsigned char>(str.front())))
+        {
+            str.remove_prefix(1);
+        }
+        if (!str.empty() && str.front() == '+') str.remove_prefix(1);
+        T value{};
+        if (std::from_chars(str.data(), str.data() + str.size(), value).ec != std::errc()) return T{};
+        return value;
+    }
+
+    // base ** exp by squaring, exp >= 0. wraps around on overflow like the other int operations
+    inline long long powInt(long long base, long long exp)
+    {
+        unsigned long long result = 1;
+        auto factor               = static_cast<unsigned long long>(base);
+        for (; exp > 0; exp >>= 1)
+        {
+            if (exp & 1) result *= factor;
+            factor *= factor;
+        }
+        return static_cast<long long>(result);
+    }
+
+    // immutable, shared by every copy of a string value
+    struct StringObject
+    {
+        explicit StringObject(std::string str) : str(std::move(str))
+        {
+        }
+        std::string str;
+        int ref_count{ 1 };
+    };
+
+    // shared by copies, copied on the first write through a shared value(copy on write)
+    struct ArrayObject
+    {
+        explicit ArrayObject(std::vector<Value> arr) : arr(std::move(arr))
+        {
+        }
+        std::vector<Value> arr;
+        int ref_count{ 1 };
+    };
+
+    // 16 bytes: ints and doubles are stored inline, strings and arrays on the heap.
+    // copying a string or an array is O(1), arrays keep value semantics through copy on write
     class Value
     {
+      public:
+        enum class Tag : unsigned char
+        {
+            NONE,
+            INT,
+            DOUBLE,
+            STRING,
+            ARRAY
+        };
+
       public:
         Value() = default;
         //
         template<typename T>
         explicit Value(T value)
         {
-            if constexpr (std::is_same<T, int>() || std::is_same<T, bool>())
-                _value = static_cast<long long>(value);
-            else
-                _value = value;
+            set(std::move(value));
         }
-        explicit operator bool()
+        Value(const Value &that)
+        {
+            copyFrom(that);
+        }
+        Value(Value &&that) noexcept
+        {
+            moveFrom(that);
+        }
+        ~Value()
+        {
+            release();
+        }
+        explicit operator bool() const
         {
             if (is<long long>() || is<double>()) return as<double>() != 0;
-            if (is<std::string>()) return as<std::string>().size() > 0;
+            if (is<std::string>()) return str().size() > 0;
             UNREACHABLE();
         }
         template<typename T>
-        Value &operator=(const T &rhs)
+        Value &operator=(T rhs)
         {
-            if constexpr (std::is_same<T, int>() || std::is_same<T, bool>())
-                _value = static_cast<long long>(rhs);
-            else
-                _value = rhs;
+            release();
+            set(std::move(rhs));
 
             return *this;
         }
         Value &operator=(const Value &rhs)
         {
-            _value = rhs._value;
+            if (!isHeap() && !rhs.isHeap())
+            {
+                tag  = rhs.tag;
+                _int = rhs._int;
+            }
+            else if (this != &rhs)
+                assignHeap(Value(rhs));
+
+            return *this;
+        }
+        Value &operator=(Value &&rhs) noexcept
+        {
+            if (this == &rhs) return *this;
+            if (!isHeap())
+                moveFrom(rhs);
+            else
+                assignHeap(std::move(rhs));
 
             return *this;
         }
@@ -57,7 +145,7 @@ namespace CYX
             }
             else if (is<long long>() && rhs.is<long long>()) // 1 + 2
             {
-                return Value(as<long long>() + rhs.as<long long>());
+                return Value(_int + rhs._int);
             }
             else if (!is<std::string>() && !rhs.is<std::string>() &&
                      (is<double>() || rhs.is<double>())) // 1 + 2.0 || 2.0 + 1
@@ -71,7 +159,7 @@ namespace CYX
 
             UNREACHABLE();
         }
-        Value operator-(Value &rhs)
+        Value operator-(const Value &rhs) const
         {
             if (is<std::string>() || rhs.is<std::string>())
             {
@@ -83,7 +171,7 @@ namespace CYX
             }
             else if (is<long long>() && rhs.is<long long>())
             {
-                return Value(as<long long>() - rhs.as<long long>());
+                return Value(_int - rhs._int);
             }
             UNREACHABLE();
         }
@@ -91,18 +179,18 @@ namespace CYX
         {
             if (is<double>())
             {
-                _value = -as<double>();
+                _double = -_double;
                 return *this;
             }
             else if (is<long long>())
             {
-                _value = -as<long long>();
+                _int = -_int;
                 return *this;
             }
             else
                 UNREACHABLE();
         }
-        Value operator*(Value &rhs)
+        Value operator*(const Value &rhs) const
         {
             if (is<std::string>() && rhs.is<std::string>()) // "a" * "b"
             {
@@ -117,12 +205,12 @@ namespace CYX
                 if (is<long long>())
                 {
                     str = rhs.as<std::string>();
-                    len = as<long long>();
+                    len = _int;
                 }
                 else
                 {
                     str = as<std::string>();
-                    len = rhs.as<long long>();
+                    len = rhs._int;
                 }
                 for (int i = 0; i < len; i++)
                 {
@@ -136,11 +224,11 @@ namespace CYX
             }
             else if (is<long long>() && rhs.is<long long>()) // 3 * 3
             {
-                return Value(as<long long>() * rhs.as<long long>());
+                return Value(_int * rhs._int);
             }
             UNREACHABLE();
         }
-        Value operator/(Value &rhs)
+        Value operator/(const Value &rhs) const
         {
             if (is<std::string>() && rhs.is<std::string>())
             {
@@ -152,79 +240,86 @@ namespace CYX
             }
             else if (is<long long>() && rhs.is<long long>()) // 1 * 1
             {
-                return Value(as<long long>() / rhs.as<long long>());
+                return Value(_int / rhs._int);
             }
             UNREACHABLE();
         }
-        Value operator%(Value &rhs)
+        Value operator%(const Value &rhs) const
         {
             if (is<long long>() && rhs.is<long long>())
             {
-                return Value(as<long long>() % rhs.as<long long>());
+                return Value(_int % rhs._int);
             }
             UNREACHABLE();
         }
-        Value operator&(Value &rhs)
+        Value operator&(const Value &rhs) const
         {
             if (is<long long>() && rhs.is<long long>())
             {
-                return Value(as<long long>() & rhs.as<long long>());
+                return Value(_int & rhs._int);
             }
             UNREACHABLE();
         }
-        bool operator&&(Value &rhs)
+        bool operator&&(const Value &rhs) const
         {
             if (is<long long>() && rhs.is<long long>())
             {
-                return as<long long>() != 0 && rhs.as<long long>() != 0;
+                return _int != 0 && rhs._int != 0;
             }
             UNREACHABLE();
         }
-        bool operator||(Value &rhs)
+        bool operator||(const Value &rhs) const
         {
             if (is<long long>() && rhs.is<long long>())
             {
-                return as<long long>() != 0 || rhs.as<long long>() != 0;
+                return _int != 0 || rhs._int != 0;
             }
             UNREACHABLE();
         }
-        Value operator|(Value &rhs)
+        Value operator|(const Value &rhs) const
         {
             if (is<long long>() && rhs.is<long long>())
             {
-                return Value(as<long long>() | rhs.as<long long>());
+                return Value(_int | rhs._int);
             }
             UNREACHABLE();
         }
-        Value operator^(Value &rhs)
+        Value operator^(const Value &rhs) const
         {
             if (is<long long>() && rhs.is<long long>())
             {
-                return Value(as<long long>() ^ rhs.as<long long>());
+                return Value(_int ^ rhs._int);
             }
             UNREACHABLE();
         }
-        Value operator>>(Value &rhs)
+        Value operator>>(const Value &rhs) const
         {
             if (is<long long>() && rhs.is<long long>())
             {
-                return Value(as<long long>() >> rhs.as<long long>());
+                return Value(_int >> rhs._int);
             }
             UNREACHABLE();
         }
-        Value operator<<(Value &rhs)
+        Value operator<<(const Value &rhs) const
         {
             if (is<long long>() && rhs.is<long long>())
             {
-                return Value(as<long long>() << rhs.as<long long>());
+                return Value(_int << rhs._int);
             }
             UNREACHABLE();
         }
-        bool operator!=(Value &rhs)
+        // int ** non-negative int is exact, anything else goes through double
+        Value power(const Value &rhs) const
         {
+            if (is<long long>() && rhs.is<long long>() && rhs._int >= 0) return Value(powInt(_int, rhs._int));
+            return Value(std::pow(as<double>(), rhs.as<double>()));
+        }
+        bool operator!=(const Value &rhs) const
+        {
+            if (is<long long>() && rhs.is<long long>()) return _int != rhs._int;
             if (is<std::string>() && rhs.is<std::string>())
             {
-                return as<std::string>() != rhs.as<std::string>();
+                return str() != rhs.str();
             }
             else if (!is<std::string>() && !rhs.is<std::string>())
             {
@@ -233,11 +328,12 @@ namespace CYX
             else
                 return true;
         }
-        bool operator==(Value &rhs)
+        bool operator==(const Value &rhs) const
         {
+            if (is<long long>() && rhs.is<long long>()) return _int == rhs._int;
             if (is<std::string>() && rhs.is<std::string>())
             {
-                return as<std::string>() == rhs.as<std::string>();
+                return str() == rhs.str();
             }
             else if (!is<std::string>() && !rhs.is<std::string>())
             {
@@ -247,11 +343,12 @@ namespace CYX
                 return true;
         }
         //
-        bool operator>(Value &rhs)
+        bool operator>(const Value &rhs) const
         {
+            if (is<long long>() && rhs.is<long long>()) return _int > rhs._int;
             if (is<std::string>() && rhs.is<std::string>())
             {
-                return as<std::string>() > rhs.as<std::string>();
+                return str() > rhs.str();
             }
             else if (!is<std::string>() && !rhs.is<std::string>())
             {
@@ -260,11 +357,12 @@ namespace CYX
             else
                 return false;
         }
-        bool operator<(Value &rhs)
+        bool operator<(const Value &rhs) const
         {
+            if (is<long long>() && rhs.is<long long>()) return _int < rhs._int;
             if (is<std::string>() && rhs.is<std::string>())
             {
-                return as<std::string>() < rhs.as<std::string>();
+                return str() < rhs.str();
             }
             else if (!is<std::string>() && !rhs.is<std::string>())
             {
@@ -273,11 +371,12 @@ namespace CYX
             else
                 return false;
         }
-        bool operator>=(Value &rhs)
+        bool operator>=(const Value &rhs) const
         {
+            if (is<long long>() && rhs.is<long long>()) return _int >= rhs._int;
             if (is<std::string>() && rhs.is<std::string>())
             {
-                return as<std::string>() >= rhs.as<std::string>();
+                return str() >= rhs.str();
             }
             else if (!is<std::string>() && !rhs.is<std::string>())
             {
@@ -286,11 +385,12 @@ namespace CYX
             else
                 return false;
         }
-        bool operator<=(Value &rhs)
+        bool operator<=(const Value &rhs) const
         {
+            if (is<long long>() && rhs.is<long long>()) return _int <= rhs._int;
             if (is<std::string>() && rhs.is<std::string>())
             {
-                return as<std::string>() <= rhs.as<std::string>();
+                return str() <= rhs.str();
             }
             else if (!is<std::string>() && !rhs.is<std::string>())
             {
@@ -300,77 +400,168 @@ namespace CYX
                 return false;
         }
         //
-        Value operator~()
+        Value operator~() const
         {
             if (is<long long>())
             {
-                return Value(~as<long long>());
+                return Value(~_int);
             }
             UNREACHABLE();
         }
-        Value operator!()
+        Value operator!() const
         {
             if (is<long long>())
             {
-                return Value(!as<long long>());
+                return Value(!_int);
             }
             UNREACHABLE();
         }
 
         //
         template<typename T>
-        bool is()
+        bool is() const
         {
-            return std::holds_alternative<T>(_value);
+            return tag == tagOf<T>();
         }
-        //
-        template<typename T>
-        T value()
+        Tag type() const
         {
-            return std::get<T>(_value);
+            return tag;
         }
+        //
         template<typename T>
-        T *valuePtr()
-        {
-            return std::get_if<T>(&_value);
+        T value() const
+        {
+            if constexpr (std::is_same<T, long long>::value)
+                return _int;
+            else if constexpr (std::is_same<T, double>::value)
+                return _double;
+            else if constexpr (std::is_same<T, std::string>::value)
+                return str();
+            else if constexpr (std::is_same<T, std::vector<Value>>::value)
+                return _array->arr;
+            else
+                static_assert(!std::is_same<T, T>::value, "unsupported type");
         }
-        bool isSameType(const Value &that)
+        bool isSameType(const Value &that) const
         {
-            return _value.index() == that._value.index();
+            return tag == that.tag;
         }
         // type conversion.
         template<typename T>
-        T as()
+        T as() const
         {
             if (is<T>()) return value<T>();
             if constexpr (std::is_same<T, std::string>::value) return asString();
             if constexpr (std::is_same<T, long long>::value) return asInt();
             if constexpr (std::is_same<T, double>::value) return asDouble();
         }
-        bool hasValue()
+        bool hasValue() const
         {
-            return _value.index() != 0;
+            return tag != Tag::NONE;
         }
         void reset()
         {
-            _value = std::monostate();
+            release();
         }
 
       private:
-        std::string asString()
+        template<typename T>
+        static constexpr Tag tagOf()
+        {
+            if constexpr (std::is_same<T, long long>::value)
+                return Tag::INT;
+            else if constexpr (std::is_same<T, double>::value)
+                return Tag::DOUBLE;
+            else if constexpr (std::is_same<T, std::string>::value)
+                return Tag::STRING;
+            else if constexpr (std::is_same<T, std::vector<Value>>::value)
+                return Tag::ARRAY;
+            else
+                return Tag::NONE;
+        }
+        template<typename T>
+        void set(T value)
+        {
+            if constexpr (std::is_integral<T>::value)
+            {
+                tag  = Tag::INT;
+                _int = static_cast<long long>(value);
+            }
+            else if constexpr (std::is_floating_point<T>::value)
+            {
+                tag     = Tag::DOUBLE;
+                _double = static_cast<double>(value);
+            }
+            else if constexpr (std::is_same<T, std::vector<Value>>::value)
+            {
+                tag    = Tag::ARRAY;
+                _array = new ArrayObject(std::move(value));
+            }
+            else if constexpr (std::is_convertible<T, std::string>::value)
+            {
+                tag     = Tag::STRING;
+                _string = new StringObject(std::string(std::move(value)));
+            }
+            else
+                static_assert(!std::is_same<T, T>::value, "unsupported type");
+        }
+        bool isHeap() const
+        {
+            return tag >= Tag::STRING;
+        }
+        void copyFrom(const Value &that)
+        {
+            tag  = that.tag;
+            _int = that._int;
+            if (tag == Tag::STRING)
+                _string->ref_count++;
+            else if (tag == Tag::ARRAY)
+                _array->ref_count++;
+        }
+        void moveFrom(Value &that)
+        {
+            tag      = that.tag;
+            _int     = that._int;
+            that.tag = Tag::NONE;
+        }
+        void release()
+        {
+            if (isHeap()) releaseHeap();
+            tag = Tag::NONE;
+        }
+        // the slow paths are kept out of the scalar ones, so those stay small enough to be inlined everywhere
+        void releaseHeap()
+        {
+            if (tag == Tag::STRING && --_string->ref_count == 0)
+                delete _string;
+            else if (tag == Tag::ARRAY && --_array->ref_count == 0)
+                delete _array;
+        }
+        void assignHeap(Value &&rhs)
+        {
+            // rhs may live inside the array we are about to release, so it is taken over first
+            Value tmp(std::move(rhs));
+            release();
+            moveFrom(tmp);
+        }
+        const std::string &str() const
+        {
+            return _string->str;
+        }
+        std::string asString() const
         {
             if (is<long long>())
-                return std::to_string(value<long long>());
+                return std::to_string(_int);
             else if (is<double>())
-                return std::to_string(value<double>());
-            else if (is<std::vector<Value>>())
+                return std::to_string(_double);
+            else if (isArray())
             {
                 std::string str = "[";
-                auto arr        = asArray();
-                for (int i = 0; i < arr->size(); i++)
+                const auto &arr = _array->arr;
+                for (int i = 0; i < arr.size(); i++)
                 {
-                    str += (*arr)[i].as<std::string>();
-                    if (i != arr->size() - 1) str += ",";
+                    str += arr[i].as<std::string>();
+                    if (i != arr.size() - 1) str += ",";
                 }
                 return str + "]";
             }
@@ -378,44 +569,30 @@ namespace CYX
                 return "";
         }
 
-        int asInt()
+        long long asInt() const
         {
             if (is<double>())
             {
-                return static_cast<long long>(value<double>());
+                return static_cast<long long>(_double);
             }
             else if (is<std::string>())
             {
-                try
-                {
-                    return std::stoll(as<std::string>());
-                }
-                catch (const std::exception &)
-                {
-                    return 0;
-                }
+                return parseNumber<long long>(str());
             }
             else
             {
                 return 0;
             }
         }
-        double asDouble()
+        double asDouble() const
         {
             if (is<long long>())
             {
-                return static_cast<double>(value<long long>());
+                return static_cast<double>(_int);
             }
             else if (is<std::string>())
             {
-                try
-                {
-                    return std::stod(as<std::string>());
-                }
-                catch (const std::exception &)
-                {
-                    return 0;
-                }
+                return parseNumber<double>(str());
             }
             else
             {
@@ -433,20 +610,45 @@ namespace CYX
                 UNREACHABLE();
             }
         }
-        bool isArray()
+        bool isArray() const
         {
-            return is<std::vector<Value>>();
+            return tag == Tag::ARRAY;
         }
+        // for writing, detach from other values first
         std::vector<Value> *asArray()
         {
-            return valuePtr<std::vector<Value>>();
+            if (!isArray()) return nullptr;
+            if (_array->ref_count > 1)
+            {
+                _array->ref_count--;
+                _array = new ArrayObject(_array->arr);
+            }
+            return &_array->arr;
+        }
+        const std::vector<Value> *asArray() const
+        {
+            return isArray() ? &_array->arr : nullptr;
+        }
+        // string specific, no copy
+        const std::string *asStr() const
+        {
+            return is<std::string>() ? &str() : nullptr;
         }
 
       private:
         // union  C++  ذ
-        std::variant<std::monostate, long long, double, std::string, std::vector<Value>> _value;
+        union
+        {
+            long long _int{ 0 };
+            double _double;
+            StringObject *_string;
+            ArrayObject *_array;
+        };
+        Tag tag{ Tag::NONE };
     };
 
+    static_assert(sizeof(void *) != 8 || sizeof(Value) == 16, "Value should be 16 bytes");
+
 } // namespace CYX
 
 #endif
@@ -1,11 +1,15 @@
 #include "bytecode_generator.h"
 
-COMPILER::BytecodeGenerator::BytecodeGenerator()
+// %0 takes comparison results and %1 the result of a call, every register window has them
+static const int RESERVED_REGISTERS = 2;
+
+COMPILER::BytecodeGenerator::BytecodeGenerator(const CompileOptions &options) : options(options)
 {
     // add buildin functions to table
-    for (const auto &x : buildin_functions)
+    const auto &buildins = buildinTable();
+    for (int i = 1; i < buildins.size(); i++)
     {
-        funcs_table[x.first.substr(8)] = 0 - x.second.second;
+        funcs_table[std::string(buildins[i].name)] = -i;
     }
 }
 
@@ -20,10 +24,22 @@ void COMPILER::BytecodeGenerator::ir2VmInst()
     genGlobalVarDecl();
     
     global_var_len = bytecode_basicblocks.back()->vm_insts.size();
+    // locals are allocated knowing which names are globals
+    cur_slot_table = &global_slot_table;
+    for (auto *inst : bytecode_basicblocks.back()->vm_insts)
+    {
+        resolveSlot(inst);
+    }
+    register_allocation.global_slot_table = &global_slot_table;
     for (auto *func : funcs)
     {
         bytecode_basicblocks.push_back(new BytecodeBasicBlock(func->name));
         block_table.clear();
+        if (!options.no_register_allocation)
+        {
+            register_allocation.allocate(func);
+            func_slot_tables[func->name] = register_allocation.slot_table;
+        }
         genFunc(func);
         for (auto *block : func->blocks)
         {
@@ -33,6 +49,8 @@ void COMPILER::BytecodeGenerator::ir2VmInst()
                 if (auto *ptr = as<IRAssign, IR::Tag::ASSIGN>(inst); ptr != nullptr)
                 {
                     genAssign(ptr);
+                    // the callee returns for this function, the RET after it is never reached
+                    if (auto *call = as<IRCall, IR::Tag::CALL>(ptr->src()); call != nullptr && call->tail) break;
                 }
                 else if (auto *ptr = as<IRBinary, IR::Tag::BINARY>(inst); ptr != nullptr)
                 {
@@ -97,7 +115,7 @@ void COMPILER::BytecodeGenerator::genBinary(COMPILER::IRBinary *ptr)
                 genLoadX(1, rhs->ssaName(), arr_idx);
                 auto *inst    = new CVM::Bnot;
                 inst->reg_idx = 1;
-                inst->name    = rhs->ssaName();
+                inst->var     = CVM::VarRef(rhs->ssaName());
                 inst->type    = CVM::ArgType::MAP;
                 addInst(inst);
                 return;
@@ -226,7 +244,8 @@ void COMPILER::BytecodeGenerator::genCall(COMPILER::IRCall *ptr)
 {
     auto *call = new CVM::Call;
     call->name = ptr->name;
-    addInst(call);
+    call->argc = ptr->args.size();
+    if (ptr->tail) call->opcode = CVM::Opcode::TAILCALL;
     for (auto *arg : ptr->args)
     {
         auto x = new CVM::Arg;
@@ -236,7 +255,7 @@ void COMPILER::BytecodeGenerator::genCall(COMPILER::IRCall *ptr)
             parseVarArr(var, arr_idx);
             x->index = arr_idx;
             x->type  = CVM::ArgType::MAP;
-            x->name  = var->ssaName();
+            x->var   = CVM::VarRef(var->ssaName());
         }
         else if (auto constant = as<IRConstant, IR::Tag::CONST>(arg); arg != nullptr)
         {
@@ -245,6 +264,17 @@ void COMPILER::BytecodeGenerator::genCall(COMPILER::IRCall *ptr)
         }
         addInst(x);
     }
+    addInst(call);
+    // int(a) converts `a` itself
+    if (const int idx = findBuildin(ptr->name); idx != 0 && buildinTable()[idx].converts_arg && ptr->args.size() == 1)
+    {
+        if (auto var = as<IRVar, IR::Tag::VAR>(ptr->args[0]); var != nullptr)
+        {
+            std::vector<CVM::ArrIdx> arr_idx;
+            parseVarArr(var, arr_idx);
+            genStoreX(var->ssaName(), 1, arr_idx);
+        }
+    }
 }
 
 void COMPILER::BytecodeGenerator::genFunc(COMPILER::IRFunction *ptr)
@@ -252,14 +282,11 @@ void COMPILER::BytecodeGenerator::genFunc(COMPILER::IRFunction *ptr)
     auto *func_inst        = new CVM::Func();
     func_inst->name        = ptr->name;
     func_inst->param_count = ptr->params.size();
-    addInst(func_inst);
-    // Param
     for (auto param : ptr->params)
     {
-        auto *p = new CVM::Param();
-        p->name = param->ssaName();
-        addInst(p);
+        func_inst->params.push_back(param->ssaName());
     }
+    addInst(func_inst);
 }
 
 void COMPILER::BytecodeGenerator::genBranch(COMPILER::IRBranch *ptr)
@@ -279,6 +306,19 @@ void COMPILER::BytecodeGenerator::genAssign(COMPILER::IRAssign *ptr)
      * storex a 1
      * */
     std::string lhs = ptr->dest()->ssaName();
+    // the result is returned by the callee itself
+    if (auto *call = as<IRCall, IR::Tag::CALL>(ptr->src()); call != nullptr && call->tail)
+    {
+        genCall(call);
+        return;
+    }
+    // nobody reads the result, only the side effects are kept
+    if (!options.no_register_allocation && register_allocation.isDeadDef(ptr))
+    {
+        if (auto *binary = as<IRBinary, IR::Tag::BINARY>(ptr->src()); binary != nullptr) genBinary(binary);
+        if (auto *call = as<IRCall, IR::Tag::CALL>(ptr->src()); call != nullptr) genCall(call);
+        return;
+    }
 
     std::vector<CVM::ArrIdx> arr_idx;
     parseVarArr(ptr->dest(), arr_idx); // handle array index start
@@ -302,6 +342,8 @@ void COMPILER::BytecodeGenerator::genAssign(COMPILER::IRAssign *ptr)
     {
         std::vector<CVM::ArrIdx> src_idx;
         parseVarArr(var, src_idx);
+        // coalesced by RegisterAllocation
+        if (arr_idx.empty() && src_idx.empty() && register_allocation.isSameSlot(lhs, var->ssaName())) return;
 
         genLoadX(1, var->ssaName(), src_idx);
         genStoreX(lhs, 1, arr_idx);
@@ -320,7 +362,7 @@ void COMPILER::BytecodeGenerator::genAssign(COMPILER::IRAssign *ptr)
             if (auto *var = as<IRVar, IR::Tag::VAR>(arr->content[i]); var != nullptr)
             {
                 value.emplace_back();
-                idx.emplace_back(var->name, i);
+                idx.emplace_back(var->ssaName(), i);
             }
             else if (auto *constant = as<IRConstant, IR::Tag::CONST>(arr->content[i]); constant != nullptr)
             {
@@ -379,7 +421,7 @@ void COMPILER::BytecodeGenerator::genLoad(int reg_idx, T val)
 void COMPILER::BytecodeGenerator::genLoadX(int reg_idx, const std::string &name)
 {
     auto *load_x    = new CVM::LoadX;
-    load_x->name    = name;
+    load_x->var     = CVM::VarRef(name);
     load_x->reg_idx = reg_idx;
     addInst(load_x);
 }
@@ -397,7 +439,7 @@ void COMPILER::BytecodeGenerator::genLoadXA(int reg_idx, const std::vector<std::
     for (const auto &x : idx)
     {
         auto *load_xa    = new CVM::LoadXA;
-        load_xa->name    = x.first;
+        load_xa->var     = CVM::VarRef(x.first);
         load_xa->reg_idx = reg_idx;
         load_xa->index   = x.second;
         addInst(load_xa);
@@ -416,7 +458,7 @@ void COMPILER::BytecodeGenerator::genStoreA(const std::string &name, CYX::Value
                                             const std::vector<CVM::ArrIdx> &idx)
 {
     auto *store_a  = new CVM::StoreA;
-    store_a->name  = name;
+    store_a->var   = CVM::VarRef(name);
     store_a->value = val;
     store_a->index = idx;
     addInst(store_a);
@@ -429,21 +471,21 @@ void COMPILER::BytecodeGenerator::genStore(const std::string &name, T val)
     {
         auto *store_i = new CVM::StoreI;
         store_i->val  = val;
-        store_i->name = name;
+        store_i->var  = CVM::VarRef(name);
         addInst(store_i);
     }
     else if constexpr (std::is_same<T, double>())
     {
         auto *store_d = new CVM::StoreD;
         store_d->val  = val;
-        store_d->name = name;
+        store_d->var  = CVM::VarRef(name);
         addInst(store_d);
     }
     else if constexpr (std::is_same<T, std::string>())
     {
         auto *store_d = new CVM::StoreS;
         store_d->val  = val;
-        store_d->name = name;
+        store_d->var  = CVM::VarRef(name);
         addInst(store_d);
     }
     else
@@ -455,7 +497,7 @@ void COMPILER::BytecodeGenerator::genStore(const std::string &name, T val)
 void COMPILER::BytecodeGenerator::genStoreX(const std::string &name, int reg_idx)
 {
     auto *store_x    = new CVM::StoreX;
-    store_x->name    = name;
+    store_x->var     = CVM::VarRef(name);
     store_x->reg_idx = reg_idx;
     addInst(store_x);
 }
@@ -473,7 +515,12 @@ void COMPILER::BytecodeGenerator::collectBlockMap()
     int cnt = bytecode_basicblocks[0]->vm_insts.size();
     for (int i = 1; i < bytecode_basicblocks.size(); i++)
     {
-        if (bytecode_basicblocks[i]->vm_insts.empty()) continue;
+        // nothing left of it(dead stores dropped), a jump to it falls through to the next block
+        if (bytecode_basicblocks[i]->vm_insts.empty())
+        {
+            block_table[bytecode_basicblocks[i]->name] = cnt;
+            continue;
+        }
         bool is_func = bytecode_basicblocks[i]->vm_insts.front()->opcode == CVM::Opcode::FUNC;
         if (is_func)
             funcs_table[bytecode_basicblocks[i]->name] = cnt;
@@ -490,6 +537,12 @@ void COMPILER::BytecodeGenerator::fixJmp()
     {
         for (auto inst : bytecode_basicblocks[i]->vm_insts)
         {
+            if (CVM::isCmpJmp(inst->opcode))
+            {
+                auto *tmp   = static_cast<CVM::CmpJmp *>(inst);
+                tmp->target = block_table[tmp->basic_block_name];
+                continue;
+            }
             if (!inOr(inst->opcode, CVM::Opcode::JMP, CVM::Opcode::JIF, CVM::Opcode::CALL)) continue;
             if (inst->opcode == CVM::Opcode::JMP)
             {
@@ -512,17 +565,177 @@ void COMPILER::BytecodeGenerator::fixCall()
     {
         for (auto inst : bytecode_basicblocks[i]->vm_insts)
         {
-            if (inst->opcode != CVM::Opcode::CALL) continue;
+            if (!inOr(inst->opcode, CVM::Opcode::CALL, CVM::Opcode::TAILCALL)) continue;
             auto *tmp   = static_cast<CVM::Call *>(inst);
             tmp->target = funcs_table[tmp->name];
         }
     }
 }
 
+void COMPILER::BytecodeGenerator::allocateSlots()
+{
+    // every variable referenced in `global_var_decl` lives in the global frame,
+    // the others get a slot of the function they appear in, params first.
+    // a name that is also a global (and not a param) refers to the global one.
+    CVM::Func *cur_func{ nullptr };
+    cur_slot_table   = &global_slot_table;
+    global_reg_count = RESERVED_REGISTERS;
+    for (auto *block : bytecode_basicblocks)
+    {
+        for (auto *inst : block->vm_insts)
+        {
+            if (inst == nullptr) continue;
+            if (inst->opcode == CVM::Opcode::FUNC)
+            {
+                if (cur_func != nullptr) cur_func->slot_count = local_slot_count;
+                cur_func            = static_cast<CVM::Func *>(inst);
+                cur_func->reg_count = RESERVED_REGISTERS;
+                cur_slot_table      = &local_slot_table;
+                local_slot_table.clear();
+                local_slot_count = 0;
+                if (auto it = func_slot_tables.find(cur_func->name); it != func_slot_tables.end())
+                {
+                    local_slot_table = it->second;
+                    for (const auto &x : local_slot_table)
+                    {
+                        local_slot_count = std::max(local_slot_count, x.second + 1);
+                    }
+                    continue;
+                }
+                // params always shadow globals, arguments are bound to slot 0..param_count-1
+                for (const auto &param : cur_func->params)
+                {
+                    if (local_slot_table.emplace(param, local_slot_count).second) local_slot_count++;
+                }
+                continue;
+            }
+            resolveSlot(inst);
+            if (cur_func != nullptr)
+                cur_func->reg_count = std::max(cur_func->reg_count, registerCount(inst));
+            else
+                global_reg_count = std::max(global_reg_count, registerCount(inst));
+        }
+    }
+    if (cur_func != nullptr) cur_func->slot_count = local_slot_count;
+    global_slot_count = global_slot_table.size();
+}
+
+void COMPILER::BytecodeGenerator::resolveSlot(CVM::VMInstruction *inst)
+{
+    switch (inst->opcode)
+    {
+        case CVM::Opcode::LOADX:
+        {
+            auto *tmp = static_cast<CVM::LoadX *>(inst);
+            resolveSlot(tmp->var);
+            resolveSlot(tmp->index);
+            break;
+        }
+        case CVM::Opcode::LOADXA: resolveSlot(static_cast<CVM::LoadXA *>(inst)->var); break;
+        case CVM::Opcode::STOREI:
+        case CVM::Opcode::STORED:
+        case CVM::Opcode::STORES: resolveSlot(static_cast<CVM::Store *>(inst)->var); break;
+        case CVM::Opcode::STOREA:
+        {
+            auto *tmp = static_cast<CVM::StoreA *>(inst);
+            resolveSlot(tmp->var);
+            resolveSlot(tmp->index);
+            break;
+        }
+        case CVM::Opcode::STOREX:
+        {
+            auto *tmp = static_cast<CVM::StoreX *>(inst);
+            resolveSlot(tmp->var);
+            resolveSlot(tmp->index);
+            break;
+        }
+        case CVM::Opcode::ARG:
+        {
+            auto *tmp = static_cast<CVM::Arg *>(inst);
+            if (tmp->type != CVM::ArgType::MAP) break;
+            resolveSlot(tmp->var);
+            resolveSlot(tmp->index);
+            break;
+        }
+        case CVM::Opcode::LNOT:
+        case CVM::Opcode::BNOT:
+        {
+            auto *tmp = static_cast<CVM::Unary *>(inst);
+            if (tmp->type == CVM::ArgType::MAP) resolveSlot(tmp->var);
+            break;
+        }
+        case CVM::Opcode::MOVX:
+        {
+            auto *tmp = static_cast<CVM::MovX *>(inst);
+            resolveSlot(tmp->dst);
+            resolveSlot(tmp->src);
+            break;
+        }
+        default:
+        {
+            if (CVM::isArithmeticX(inst->opcode))
+            {
+                auto *tmp = static_cast<CVM::ArithmeticX *>(inst);
+                resolveSlot(tmp->dst);
+                resolveSlot(tmp->src1);
+                if (!tmp->isImm()) resolveSlot(tmp->src2);
+            }
+            else if (CVM::isCmpJmp(inst->opcode))
+            {
+                auto *tmp = static_cast<CVM::CmpJmp *>(inst);
+                resolveSlot(tmp->src1);
+                if (!tmp->isImm()) resolveSlot(tmp->src2);
+            }
+            break;
+        }
+    }
+}
+
+int COMPILER::BytecodeGenerator::registerCount(CVM::VMInstruction *inst)
+{
+    int count = 0;
+    if (auto *load = dynamic_cast<CVM::Load *>(inst); load != nullptr) count = std::max(count, load->reg_idx + 1);
+    if (auto *store = dynamic_cast<CVM::StoreX *>(inst); store != nullptr)
+        count = std::max(count, store->reg_idx + 1);
+    if (auto *unary = dynamic_cast<CVM::Unary *>(inst); unary != nullptr) count = std::max(count, unary->reg_idx + 1);
+    if (auto *binary = dynamic_cast<CVM::Binary *>(inst); binary != nullptr)
+        count = std::max({ count, binary->reg_idx1 + 1, binary->reg_idx2 + 1 });
+    return count;
+}
+
+void COMPILER::BytecodeGenerator::resolveSlot(CVM::VarRef &var)
+{
+    const bool is_global = cur_slot_table == &global_slot_table;
+    if (auto it = cur_slot_table->find(var.name); it != cur_slot_table->end())
+    {
+        var.slot   = it->second;
+        var.global = is_global;
+        return;
+    }
+    if (auto it = global_slot_table.find(var.name); it != global_slot_table.end())
+    {
+        var.slot   = it->second;
+        var.global = true;
+        return;
+    }
+    var.slot                    = is_global ? global_slot_table.size() : local_slot_count++;
+    var.global                  = is_global;
+    (*cur_slot_table)[var.name] = var.slot;
+}
+
+void COMPILER::BytecodeGenerator::resolveSlot(std::vector<CVM::ArrIdx> &index)
+{
+    for (auto &idx : index)
+    {
+        if (auto *var = std::get_if<CVM::VarRef>(&idx); var != nullptr) resolveSlot(*var);
+    }
+}
+
 void COMPILER::BytecodeGenerator::relocation()
 {
     // we need to adjust the target where jmp or call will jump
     // and transform to vector at the end
+    allocateSlots();
     collectBlockMap();
     fixJmp();
     fixCall();
@@ -535,6 +748,12 @@ void COMPILER::BytecodeGenerator::relocation()
         }
         if (block->name == entry_end_block_name) entry_end = vm_insts.size() - 1;
     }
+    program.assemble(vm_insts);
+    program.entry             = entry;
+    program.entry_end         = entry_end;
+    program.global_var_len    = global_var_len;
+    program.global_slot_count = global_slot_count;
+    program.global_reg_count  = global_reg_count;
 }
 
 std::string COMPILER::BytecodeGenerator::vmInstStr()
@@ -566,7 +785,7 @@ void COMPILER::BytecodeGenerator::parseVarArr(COMPILER::IRVar *var, std::vector<
         }
         else if (idx_var != nullptr)
         {
-            arr_idx.emplace_back(idx_var->ssaName());
+            arr_idx.emplace_back(CVM::VarRef(idx_var->ssaName()));
         }
         else
             UNREACHABLE();
@@ -4,10 +4,12 @@
 #include "../../common/buildin.hpp"
 #include "../../common/config.h"
 #include "../../core/opcode.hpp"
+#include "../../core/program.h"
 #include "../../core/vm_instruction.hpp"
 #include "../../utility/utility.hpp"
 #include "../ir/ir_instruction.hpp"
 #include "bytecode_basicblock.hpp"
+#include "register_allocation.h"
 
 #include <string>
 #include <unordered_map>
@@ -18,7 +20,7 @@ namespace COMPILER
     class BytecodeGenerator
     {
       public:
-        BytecodeGenerator();
+        explicit BytecodeGenerator(const CompileOptions &options);
         void ir2VmInst();
         void relocation();
         std::string vmInstStr();
@@ -29,6 +31,13 @@ namespace COMPILER
         void collectBlockMap();
         void fixJmp();
         void fixCall();
+        // map variable names to dense frame slots
+        void allocateSlots();
+        void resolveSlot(CVM::VMInstruction *inst);
+        void resolveSlot(CVM::VarRef &var);
+        void resolveSlot(std::vector<CVM::ArrIdx> &index);
+        // registers `inst` needs in the window of its frame
+        int registerCount(CVM::VMInstruction *inst);
         //
         void genBinary(IRBinary *ptr);
         void genLoadConst(CYX::Value &val, int reg_idx);
@@ -62,15 +71,27 @@ namespace COMPILER
         int entry{ -1 };
         int entry_end{ -1 };
         int global_var_len{ -1 };
+        int global_slot_count{ 0 };
+        int global_reg_count{ 0 };
         std::vector<IRFunction *> funcs;
         std::vector<CVM::VMInstruction *> vm_insts;
         std::vector<BytecodeBasicBlock *> bytecode_basicblocks;
+        CVM::Program program;
         BasicBlock *global_vars{ nullptr };
 
       private:
+        const CompileOptions options;
         std::string entry_end_block_name;
         std::unordered_map<std::string, int> block_table;
         std::unordered_map<std::string, int> funcs_table;
+        // variable name -> slot
+        std::unordered_map<std::string, int> global_slot_table;
+        std::unordered_map<std::string, int> local_slot_table;
+        std::unordered_map<std::string, int> *cur_slot_table{ nullptr };
+        int local_slot_count{ 0 };
+        // function name -> slots given by RegisterAllocation
+        std::unordered_map<std::string, std::unordered_map<std::string, int>> func_slot_tables;
+        RegisterAllocation register_allocation;
     };
 } // namespace COMPILER
 
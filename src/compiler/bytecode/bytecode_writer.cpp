@@ -41,14 +41,23 @@ void COMPILER::BytecodeWriter::writeInsts()
             case CVM::Opcode::STOREA: writeStoreA(); break;
             case CVM::Opcode::LOADX: writeLoadX(); break;
             case CVM::Opcode::STOREX: writeStoreX(); break;
-            case CVM::Opcode::CALL: writeCall(); break;
+            case CVM::Opcode::CALL:
+            case CVM::Opcode::TAILCALL: writeCall(); break;
             case CVM::Opcode::FUNC: writeFunc(); break;
             case CVM::Opcode::ARG: writeArg(); break;
-            case CVM::Opcode::PARAM: writeParam(); break;
             case CVM::Opcode::RET: writeRet(); break;
             case CVM::Opcode::JMP: writeJmp(); break;
             case CVM::Opcode::JIF: writeJif(); break;
-            default: CERR("unsupported instruction");
+            case CVM::Opcode::MOVX: writeMovX(); break;
+            default:
+            {
+                if (CVM::isArithmeticX(inst->opcode))
+                    writeArithmeticX();
+                else if (CVM::isCmpJmp(inst->opcode))
+                    writeCmpJmp();
+                else
+                    CERR("unsupported instruction");
+            }
         }
     }
 }
@@ -59,12 +68,14 @@ void COMPILER::BytecodeWriter::writeHeader()
     // magic number
     writeByte(0xc2);
     // version
-    writeByte(0x01);
+    writeByte(0x06);
     // entry point
     writeInt(entry);
     // main end
     writeInt(entry_end);
     writeInt(global_var_len);
+    writeInt(global_slot_count);
+    writeInt(global_reg_count);
 }
 
 void COMPILER::BytecodeWriter::writeByte(unsigned char val)
@@ -113,7 +124,7 @@ void COMPILER::BytecodeWriter::writeUnary()
     if (tmp->type == CVM::ArgType::MAP)
     {
         writeStringTag();
-        writeString(tmp->name);
+        writeVarRef(tmp->var);
     }
     else
     {
@@ -159,7 +170,7 @@ void COMPILER::BytecodeWriter::writeLoadXA()
     auto *tmp = static_cast<CVM::LoadXA *>(cur_inst);
     writeByte(tmp->reg_idx);
     writeInt(tmp->index);
-    writeString(tmp->name);
+    writeVarRef(tmp->var);
 }
 
 void COMPILER::BytecodeWriter::writeLoadX()
@@ -167,7 +178,7 @@ void COMPILER::BytecodeWriter::writeLoadX()
     // LOAD DEST SRC
     auto *tmp = static_cast<CVM::LoadX *>(cur_inst);
     writeByte(tmp->reg_idx);
-    writeString(tmp->name);
+    writeVarRef(tmp->var);
     writeArrIdx(tmp->index);
 }
 
@@ -200,21 +211,8 @@ void COMPILER::BytecodeWriter::writeStoreX()
 {
     // STORE DEST SRC
     auto *tmp = static_cast<CVM::StoreX *>(cur_inst);
-    writeString(tmp->name);
-    writeInt(tmp->index.size());
-    for (auto idx : tmp->index)
-    {
-        if (std::holds_alternative<long long>(idx))
-        {
-            writeIntTag();
-            writeInt(std::get<long long>(idx));
-        }
-        else
-        {
-            writeStringTag();
-            writeString(std::get<std::string>(idx));
-        }
-    }
+    writeVarRef(tmp->var);
+    writeArrIdx(tmp->index);
     writeByte(tmp->reg_idx);
 }
 
@@ -222,7 +220,7 @@ void COMPILER::BytecodeWriter::writeStoreA()
 {
     // STOREA a[1][b] = 3.14
     auto *tmp = static_cast<CVM::StoreA *>(cur_inst);
-    writeString(tmp->name);
+    writeVarRef(tmp->var);
     // [1][b]
     writeArrIdx(tmp->index);
     // 3.14
@@ -249,19 +247,19 @@ void COMPILER::BytecodeWriter::writeStore()
     if constexpr (std::is_same<T, long long>())
     {
         auto *tmp = static_cast<CVM::StoreI *>(cur_inst);
-        writeString(tmp->name);
+        writeVarRef(tmp->var);
         writeInt(tmp->val);
     }
     else if constexpr (std::is_same<T, double>())
     {
         auto *tmp = static_cast<CVM::StoreD *>(cur_inst);
-        writeString(tmp->name);
+        writeVarRef(tmp->var);
         writeDouble(tmp->val);
     }
     else if constexpr (std::is_same<T, std::string>())
     {
         auto *tmp = static_cast<CVM::StoreS *>(cur_inst);
-        writeString(tmp->name);
+        writeVarRef(tmp->var);
         writeString(tmp->val);
     }
     else
@@ -275,7 +273,7 @@ void COMPILER::BytecodeWriter::writeArg()
     if (arg->type == CVM::ArgType::MAP)
     {
         writeByte(0);
-        writeString(arg->name);
+        writeVarRef(arg->var);
         writeArrIdx(arg->index);
     }
     else if (arg->type == CVM::ArgType::RAW)
@@ -304,18 +302,15 @@ void COMPILER::BytecodeWriter::writeCall()
 {
     auto *tmp = static_cast<CVM::Call *>(cur_inst);
     writeInt(tmp->target); // func line no
+    writeInt(tmp->argc);
 }
 
 void COMPILER::BytecodeWriter::writeFunc()
 {
     auto *tmp = static_cast<CVM::Func *>(cur_inst);
     writeByte(tmp->param_count); // argument count
-}
-
-void COMPILER::BytecodeWriter::writeParam()
-{
-    auto *tmp = static_cast<CVM::Param *>(cur_inst);
-    writeString(tmp->name);
+    writeInt(tmp->slot_count);   // frame size
+    writeInt(tmp->reg_count);    // registers after the slots
 }
 
 void COMPILER::BytecodeWriter::writeRet()
@@ -336,6 +331,35 @@ void COMPILER::BytecodeWriter::writeJif()
     writeInt(tmp->target2);
 }
 
+void COMPILER::BytecodeWriter::writeArithmeticX()
+{
+    auto *tmp = static_cast<CVM::ArithmeticX *>(cur_inst);
+    writeVarRef(tmp->dst);
+    writeVarRef(tmp->src1);
+    if (tmp->isImm())
+        writeImm(tmp->imm);
+    else
+        writeVarRef(tmp->src2);
+}
+
+void COMPILER::BytecodeWriter::writeCmpJmp()
+{
+    auto *tmp = static_cast<CVM::CmpJmp *>(cur_inst);
+    writeVarRef(tmp->src1);
+    if (tmp->isImm())
+        writeImm(tmp->imm);
+    else
+        writeVarRef(tmp->src2);
+    writeInt(tmp->target);
+}
+
+void COMPILER::BytecodeWriter::writeMovX()
+{
+    auto *tmp = static_cast<CVM::MovX *>(cur_inst);
+    writeVarRef(tmp->dst);
+    writeVarRef(tmp->src);
+}
+
 void COMPILER::BytecodeWriter::writeIntTag()
 {
     writeByte(0);
@@ -356,10 +380,33 @@ void COMPILER::BytecodeWriter::writeEmptyTag()
     writeByte(3);
 }
 
+void COMPILER::BytecodeWriter::writeImm(const CYX::Value &imm)
+{
+    // immediate of superinstructions, int or double
+    if (imm.is<long long>())
+    {
+        writeIntTag();
+        writeInt(imm.as<long long>());
+    }
+    else
+    {
+        writeDoubleTag();
+        writeDouble(imm.as<double>());
+    }
+}
+
+void COMPILER::BytecodeWriter::writeVarRef(const CVM::VarRef &var)
+{
+    // name is kept for dumping only, vm uses slot
+    writeString(var.name);
+    writeInt(var.slot);
+    writeByte(var.global ? 1 : 0);
+}
+
 void COMPILER::BytecodeWriter::writeArrIdx(const std::vector<CVM::ArrIdx> &arr_idx)
 {
     writeInt(arr_idx.size());
-    for (auto idx : arr_idx)
+    for (const auto &idx : arr_idx)
     {
         if (std::holds_alternative<long long>(idx))
         {
@@ -369,7 +416,7 @@ void COMPILER::BytecodeWriter::writeArrIdx(const std::vector<CVM::ArrIdx> &arr_i
         else
         {
             writeStringTag();
-            writeString(std::get<std::string>(idx));
+            writeVarRef(std::get<CVM::VarRef>(idx));
         }
     }
 }
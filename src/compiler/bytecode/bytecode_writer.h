@@ -44,15 +44,20 @@ namespace COMPILER
         void writeArg();
         void writeCall();
         void writeFunc();
-        void writeParam();
         void writeRet();
         void writeJmp();
         void writeJif();
         //
+        void writeArithmeticX();
+        void writeCmpJmp();
+        void writeMovX();
+        //
         void writeIntTag();
         void writeDoubleTag();
         void writeStringTag();
         void writeEmptyTag();
+        void writeImm(const CYX::Value &imm);
+        void writeVarRef(const CVM::VarRef &var);
         void writeArrIdx(const std::vector<CVM::ArrIdx> &arr_idx);
 
       private:
@@ -64,6 +69,8 @@ namespace COMPILER
         int entry{ -1 };
         int entry_end{ -1 };
         int global_var_len{ -1 };
+        int global_slot_count{ 0 };
+        int global_reg_count{ 0 };
         std::vector<CVM::VMInstruction *> vm_insts;
         void writeUnary();
     };
@@ -26,6 +26,8 @@ void COMPILER::PeepholeOptimization::traversal()
         changed = false;
         for (auto &block : *block_list)
         {
+            // registers never live across blocks, a block may be entered from anywhere
+            window.clear();
             for (auto it = block->vm_insts.begin(); it != block->vm_insts.end();)
             {
                 auto inst = *it;
@@ -36,7 +38,9 @@ void COMPILER::PeepholeOptimization::traversal()
                           CVM::Opcode::LOADX, //
                           CVM::Opcode::JMP, CVM::Opcode::JIF))
                 {
-                    if (inst == nullptr) window.clear();
+                    // a call clobbers %1, nothing before it can be reused
+                    if (inst == nullptr || inOr(inst->opcode, CVM::Opcode::CALL, CVM::Opcode::TAILCALL))
+                        window.clear();
                     it++;
                     continue;
                 }
@@ -54,11 +58,13 @@ void COMPILER::PeepholeOptimization::pass(
     // if removed some code, `cur_it` will do nothing at the end of this function
     // else `cur_it++`
     auto remove_code = false;
-    const auto len   = window.size();
+    auto len         = window.size();
     auto checkTarget = [this](const std::string &target_name)
     {
         // check whether the front instruction of the target block is a jmp instruction
-        auto tmp = (*block_list)[jump_map[target_name]]->vm_insts.front();
+        const auto &target = (*block_list)[jump_map[target_name]]->vm_insts;
+        if (target.empty()) return target_name;
+        auto tmp = target.front();
         if (tmp->opcode == CVM::Opcode::JMP) return static_cast<CVM::Jmp *>(tmp)->basic_block_name;
         return target_name;
     };
@@ -75,9 +81,9 @@ void COMPILER::PeepholeOptimization::pass(
         auto storex2 = dynamic_cast<CVM::StoreX *>(*window[len - 1].second);
         auto loadx   = dynamic_cast<CVM::LoadX *>(*window[len - 1].second);
         if (storex == nullptr || (loadx == nullptr && storex2 == nullptr)) return false;
-        if ((loadx != nullptr && storex->name == loadx->name && storex->reg_idx == loadx->reg_idx &&
+        if ((loadx != nullptr && storex->var.name == loadx->var.name && storex->reg_idx == loadx->reg_idx &&
              storex->index.empty() && loadx->index.empty()) ||
-            (storex2 != nullptr && storex->name == storex2->name && storex->reg_idx == storex2->reg_idx &&
+            (storex2 != nullptr && storex->var.name == storex2->var.name && storex->reg_idx == storex2->reg_idx &&
              storex->index.empty() && storex2->index.empty()))
         {
             delete *window[len - 1].second;
@@ -213,9 +219,13 @@ void COMPILER::PeepholeOptimization::pass(
         return false;
     };
 
+    // a pass removing an instruction shrinks the window for the next ones
     remove_code |= loadStorePass();
+    len = window.size();
     remove_code |= jmpJmpPass();
+    len = window.size();
     remove_code |= jifSamePass();
+    len = window.size();
     remove_code |= storeJifPass();
     jmpToJmpPass();
     jifPass();
@@ -0,0 +1,341 @@
+#include "register_allocation.h"
+
+#include <algorithm>
+
+void COMPILER::LiveInterval::addRange(int from, int to)
+{
+    if (from >= to) return;
+    // keep the ranges sorted, merge the ones overlapping or touching [from, to)
+    auto it = ranges.begin();
+    while (it != ranges.end() && it->second < from)
+    {
+        it++;
+    }
+    while (it != ranges.end() && it->first <= to)
+    {
+        from = std::min(from, it->first);
+        to   = std::max(to, it->second);
+        it   = ranges.erase(it);
+    }
+    ranges.insert(it, { from, to });
+}
+
+bool COMPILER::LiveInterval::covers(int pos) const
+{
+    return std::any_of(ranges.begin(), ranges.end(),
+                       [pos](const auto &range) { return range.first <= pos && pos < range.second; });
+}
+
+bool COMPILER::LiveInterval::intersects(const LiveInterval &interval) const
+{
+    auto lhs = ranges.begin();
+    auto rhs = interval.ranges.begin();
+    while (lhs != ranges.end() && rhs != interval.ranges.end())
+    {
+        if (lhs->first < rhs->second && rhs->first < lhs->second) return true;
+        if (lhs->second <= rhs->second)
+            lhs++;
+        else
+            rhs++;
+    }
+    return false;
+}
+
+void COMPILER::RegisterAllocation::allocate(COMPILER::IRFunction *func)
+{
+    clear();
+    for (auto *param : func->params)
+    {
+        param_names.insert(param->ssaName());
+    }
+    numberInsts(func);
+    for (auto *block : func->blocks)
+    {
+        computeLocalLiveness(block);
+    }
+    computeGlobalLiveness(func);
+    buildIntervals(func);
+    linearScan(func);
+}
+
+bool COMPILER::RegisterAllocation::isDeadDef(COMPILER::IRAssign *inst) const
+{
+    auto *dest = wholeDef(inst);
+    if (dest == nullptr) return false;
+    auto it = intervals.find(dest->ssaName());
+    if (it == intervals.end()) return false;
+    return !it->second.covers(inst->id + 1);
+}
+
+bool COMPILER::RegisterAllocation::isSameSlot(const std::string &lhs, const std::string &rhs) const
+{
+    auto lhs_it = slot_table.find(lhs);
+    auto rhs_it = slot_table.find(rhs);
+    return lhs_it != slot_table.end() && rhs_it != slot_table.end() && lhs_it->second == rhs_it->second;
+}
+
+void COMPILER::RegisterAllocation::clear()
+{
+    param_names.clear();
+    succs.clear();
+    intervals.clear();
+    slot_table.clear();
+    slot_count = 0;
+}
+
+void COMPILER::RegisterAllocation::numberInsts(COMPILER::IRFunction *func)
+{
+    int pos = 2;
+    for (auto *block : func->blocks)
+    {
+        block->from = pos;
+        for (auto *inst : block->insts)
+        {
+            inst->id = pos;
+            pos += 2;
+        }
+        block->to = pos;
+    }
+}
+
+void COMPILER::RegisterAllocation::computeLocalLiveness(COMPILER::BasicBlock *block)
+{
+    block->gen.clear();
+    block->kill.clear();
+    block->live_in.clear();
+    block->live_out.clear();
+    std::vector<std::string> uses;
+    for (auto *inst : executedInsts(block))
+    {
+        uses.clear();
+        collectUses(inst, uses);
+        for (const auto &use : uses)
+        {
+            if (block->kill.count(use) == 0) block->gen.insert(use);
+        }
+        if (auto *def = wholeDef(inst); def != nullptr && isLocal(def->ssaName())) block->kill.insert(def->ssaName());
+    }
+}
+
+void COMPILER::RegisterAllocation::computeGlobalLiveness(COMPILER::IRFunction *func)
+{
+    std::vector<BasicBlock *> blocks(func->blocks.rbegin(), func->blocks.rend());
+    for (auto *block : blocks)
+    {
+        succs[block] = successors(func, block);
+    }
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (auto *block : blocks)
+        {
+            for (auto *succ : succs[block])
+            {
+                block->live_out.insert(succ->live_in.begin(), succ->live_in.end());
+            }
+            auto live_in = block->gen;
+            for (const auto &name : block->live_out)
+            {
+                if (block->kill.count(name) == 0) live_in.insert(name);
+            }
+            if (live_in.size() != block->live_in.size())
+            {
+                block->live_in = std::move(live_in);
+                changed        = true;
+            }
+        }
+    }
+}
+
+void COMPILER::RegisterAllocation::buildIntervals(COMPILER::IRFunction *func)
+{
+    std::vector<std::string> uses;
+    for (auto block_it = func->blocks.rbegin(); block_it != func->blocks.rend(); block_it++)
+    {
+        auto *block = *block_it;
+        for (const auto &name : block->live_out)
+        {
+            interval(name).addRange(block->from, block->to);
+        }
+        const auto insts = executedInsts(block);
+        for (auto inst_it = insts.rbegin(); inst_it != insts.rend(); inst_it++)
+        {
+            auto *inst = *inst_it;
+            if (auto *def = wholeDef(inst); def != nullptr && isLocal(def->ssaName()))
+            {
+                // cut the range reaching the definition, or keep the slot for the store of a dead one
+                auto &def_interval = interval(def->ssaName());
+                if (!def_interval.ranges.empty() && def_interval.ranges.front().first <= inst->id)
+                    def_interval.ranges.front().first = inst->id;
+                else
+                    def_interval.addRange(inst->id, inst->id + 1);
+                // `a = b` and `a = b + c` can reuse the slot of `b` if it dies there
+                auto *src = static_cast<IRAssign *>(inst)->src();
+                if (auto *binary = as<IRBinary, IR::Tag::BINARY>(src); binary != nullptr) src = binary->lhs;
+                auto *src_var = as<IRVar, IR::Tag::VAR>(src);
+                if (src_var != nullptr && src_var->index.empty() && isLocal(src_var->ssaName()))
+                    def_interval.hint = src_var->ssaName();
+            }
+            uses.clear();
+            collectUses(inst, uses);
+            for (const auto &use : uses)
+            {
+                interval(use).addRange(block->from, inst->id);
+            }
+        }
+    }
+    // params are defined on entry, a variable read before any definition must stay empty till then
+    for (const auto &param : param_names)
+    {
+        interval(param).addRange(0, 1);
+    }
+    if (func->blocks.empty()) return;
+    auto *entry = func->blocks.front();
+    for (const auto &name : entry->live_in)
+    {
+        interval(name).addRange(0, entry->from);
+    }
+}
+
+void COMPILER::RegisterAllocation::linearScan(COMPILER::IRFunction *func)
+{
+    std::vector<std::vector<LiveInterval *>> slots;
+    auto assign = [&](LiveInterval *interval, int slot)
+    {
+        if (slot >= slots.size()) slots.resize(slot + 1);
+        slots[slot].push_back(interval);
+        interval->slot             = slot;
+        slot_table[interval->name] = slot;
+    };
+    auto isFree = [&](LiveInterval *interval, int slot)
+    {
+        return std::none_of(slots[slot].begin(), slots[slot].end(),
+                            [interval](const LiveInterval *x) { return x->intersects(*interval); });
+    };
+    // arguments are bound to slot 0..param_count-1
+    for (auto *param : func->params)
+    {
+        if (slot_table.count(param->ssaName()) != 0) continue;
+        assign(&intervals[param->ssaName()], slots.size());
+    }
+    std::vector<LiveInterval *> unhandled;
+    for (auto &x : intervals)
+    {
+        if (x.second.slot < 0 && !x.second.ranges.empty()) unhandled.push_back(&x.second);
+    }
+    std::sort(unhandled.begin(), unhandled.end(),
+              [](const LiveInterval *lhs, const LiveInterval *rhs)
+              { return lhs->from() != rhs->from() ? lhs->from() < rhs->from() : lhs->name < rhs->name; });
+    for (auto *cur : unhandled)
+    {
+        int slot = -1;
+        if (auto it = slot_table.find(cur->hint); it != slot_table.end() && isFree(cur, it->second)) slot = it->second;
+        for (int i = 0; slot < 0 && i < slots.size(); i++)
+        {
+            if (isFree(cur, i)) slot = i;
+        }
+        assign(cur, slot < 0 ? slots.size() : slot);
+    }
+    slot_count = slots.size();
+}
+
+std::vector<COMPILER::BasicBlock *> COMPILER::RegisterAllocation::successors(COMPILER::IRFunction *func,
+                                                                            COMPILER::BasicBlock *block)
+{
+    // follow the terminators rather than `succs`, a block without one falls through in the bytecode
+    if (const auto insts = executedInsts(block); !insts.empty())
+    {
+        auto *last = insts.back();
+        if (auto *jmp = as<IRJump, IR::Tag::JMP>(last); jmp != nullptr) return { jmp->target };
+        if (auto *branch = as<IRBranch, IR::Tag::BRANCH>(last); branch != nullptr)
+            return { branch->true_block, branch->false_block };
+        if (last->tag == IR::Tag::RETURN) return {};
+    }
+    auto it = std::find(func->blocks.begin(), func->blocks.end(), block);
+    if (it == func->blocks.end() || ++it == func->blocks.end()) return {};
+    return { *it };
+}
+
+std::vector<COMPILER::IRInst *> COMPILER::RegisterAllocation::executedInsts(COMPILER::BasicBlock *block)
+{
+    // instructions behind the first jump, branch or return are never reached
+    std::vector<IRInst *> insts;
+    for (auto *inst : block->insts)
+    {
+        insts.push_back(inst);
+        if (inOr(inst->tag, IR::Tag::JMP, IR::Tag::BRANCH, IR::Tag::RETURN)) break;
+    }
+    return insts;
+}
+
+void COMPILER::RegisterAllocation::collectUses(COMPILER::IR *inst, std::vector<std::string> &uses)
+{
+    auto collectValue = [&](IR *value)
+    {
+        if (auto *var = as<IRVar, IR::Tag::VAR>(value); var != nullptr) collectVarUses(var, uses);
+    };
+    if (auto *assign = as<IRAssign, IR::Tag::ASSIGN>(inst); assign != nullptr)
+    {
+        // a[i] = x updates `a`, so it is read
+        if (!assign->dest()->index.empty()) collectVarUses(assign->dest(), uses);
+        auto *src = assign->src();
+        if (auto *binary = as<IRBinary, IR::Tag::BINARY>(src); binary != nullptr)
+        {
+            collectValue(binary->lhs);
+            collectValue(binary->rhs);
+        }
+        else if (auto *arr = as<IRArray, IR::Tag::ARRAY>(src); arr != nullptr)
+        {
+            for (auto *x : arr->content)
+            {
+                collectValue(x);
+            }
+        }
+        else if (src != nullptr && src->tag == IR::Tag::CALL)
+            collectUses(src, uses);
+        else
+            collectValue(src);
+    }
+    else if (auto *call = as<IRCall, IR::Tag::CALL>(inst); call != nullptr)
+    {
+        for (auto *arg : call->args)
+        {
+            collectValue(arg);
+        }
+    }
+    else if (auto *ret = as<IRReturn, IR::Tag::RETURN>(inst); ret != nullptr)
+        collectValue(ret->ret);
+    else if (auto *branch = as<IRBranch, IR::Tag::BRANCH>(inst); branch != nullptr)
+        collectValue(branch->cond);
+}
+
+void COMPILER::RegisterAllocation::collectVarUses(COMPILER::IRVar *var, std::vector<std::string> &uses)
+{
+    if (isLocal(var->ssaName())) uses.push_back(var->ssaName());
+    for (auto *idx : var->index)
+    {
+        if (auto *idx_var = as<IRVar, IR::Tag::VAR>(idx); idx_var != nullptr && isLocal(idx_var->ssaName()))
+            uses.push_back(idx_var->ssaName());
+    }
+}
+
+COMPILER::IRVar *COMPILER::RegisterAllocation::wholeDef(COMPILER::IR *inst)
+{
+    auto *assign = as<IRAssign, IR::Tag::ASSIGN>(inst);
+    if (assign == nullptr || !assign->dest()->index.empty()) return nullptr;
+    return assign->dest();
+}
+
+bool COMPILER::RegisterAllocation::isLocal(const std::string &name) const
+{
+    if (param_names.count(name) != 0) return true;
+    return global_slot_table == nullptr || global_slot_table->count(name) == 0;
+}
+
+COMPILER::LiveInterval &COMPILER::RegisterAllocation::interval(const std::string &name)
+{
+    auto &x = intervals[name];
+    x.name  = name;
+    return x;
+}
@@ -0,0 +1,82 @@
+#ifndef CYX2_REGISTER_ALLOCATION_H
+#define CYX2_REGISTER_ALLOCATION_H
+
+#include "../../common/buildin.hpp"
+#include "../../common/config.h"
+#include "../../utility/utility.hpp"
+#include "../ir/basicblock.hpp"
+#include "../ir/ir_instruction.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace COMPILER
+{
+    // lifetime of one local variable, sorted and disjoint [from, to) ranges of instruction positions
+    struct LiveInterval
+    {
+        std::string name;
+        std::vector<std::pair<int, int>> ranges;
+        int slot{ -1 };
+        std::string hint; // copy source, sharing its slot turns the copy into nothing
+
+        int from() const
+        {
+            return ranges.front().first;
+        }
+        void addRange(int from, int to);
+        bool covers(int pos) const;
+        bool intersects(const LiveInterval &interval) const;
+    };
+
+    // linear scan allocation of the local variables of one function to the slots of its frame,
+    // the slots are what superinstructions and the VM address as registers.
+    //
+    // block liveness(gen, kill, live_in, live_out) gives every variable an interval with holes, variables whose
+    // intervals never meet share a slot. a copy whose source dies at it gets the slot of the source and disappears,
+    // a definition that is never read is not stored.
+    //
+    // positions: params are defined at 0, the i-th instruction of the function is at 2(i+1), a value read by an
+    // instruction is live up to it(exclusive) so the result of the same instruction can take over its slot.
+    class RegisterAllocation
+    {
+      public:
+        void allocate(IRFunction *func);
+        // the variable `inst` defines is never read afterwards
+        bool isDeadDef(IRAssign *inst) const;
+        // both are locals living in the same slot
+        bool isSameSlot(const std::string &lhs, const std::string &rhs) const;
+
+      public:
+        const std::unordered_map<std::string, int> *global_slot_table{ nullptr };
+        std::unordered_map<std::string, int> slot_table;
+        int slot_count{ 0 };
+
+      private:
+        void clear();
+        void numberInsts(IRFunction *func);
+        void computeLocalLiveness(BasicBlock *block);
+        void computeGlobalLiveness(IRFunction *func);
+        void buildIntervals(IRFunction *func);
+        void linearScan(IRFunction *func);
+        //
+        std::vector<BasicBlock *> successors(IRFunction *func, BasicBlock *block);
+        static std::vector<IRInst *> executedInsts(BasicBlock *block);
+        // variables `inst` reads / writes as a whole, named as BytecodeGenerator emits them
+        void collectUses(IR *inst, std::vector<std::string> &uses);
+        void collectVarUses(IRVar *var, std::vector<std::string> &uses);
+        static IRVar *wholeDef(IR *inst);
+        bool isLocal(const std::string &name) const;
+        LiveInterval &interval(const std::string &name);
+
+      private:
+        std::unordered_set<std::string> param_names;
+        std::unordered_map<BasicBlock *, std::vector<BasicBlock *>> succs;
+        std::unordered_map<std::string, LiveInterval> intervals;
+    };
+} // namespace COMPILER
+
+#endif // CYX2_REGISTER_ALLOCATION_H
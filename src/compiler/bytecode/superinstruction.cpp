@@ -0,0 +1,188 @@
+#include "superinstruction.h"
+
+void COMPILER::SuperInstruction::doSuperInstruction()
+{
+    for (auto *block : *block_list)
+    {
+        block->vm_insts.remove(nullptr);
+    }
+    for (int i = 0; i < block_list->size(); i++)
+    {
+        auto *block = (*block_list)[i];
+        // the true target of a JIF can only be fallen through if it is emitted right after this block
+        std::string next_block;
+        for (int j = i + 1; j < block_list->size(); j++)
+        {
+            if ((*block_list)[j]->vm_insts.empty()) continue;
+            next_block = (*block_list)[j]->name;
+            break;
+        }
+        for (auto it = block->vm_insts.begin(); it != block->vm_insts.end();)
+        {
+            if (fuseArithmetic(block, it) || fuseCmpJmp(block, next_block, it) || fuseMove(block, it)) continue;
+            it++;
+        }
+    }
+}
+
+bool COMPILER::SuperInstruction::fuseArithmetic(BytecodeBasicBlock *block, InstIter &it)
+{
+    if (!matchOperands(block, it)) return false;
+    const auto op_it    = std::next(it, 2);
+    const auto store_it = std::next(op_it);
+    if (op_it == block->vm_insts.end() || store_it == block->vm_insts.end()) return false;
+    if (!inOr((*op_it)->opcode, CVM::Opcode::ADD, CVM::Opcode::SUB, CVM::Opcode::MUL, CVM::Opcode::DIV,
+              CVM::Opcode::MOD))
+        return false;
+    auto *op     = static_cast<CVM::Binary *>(*op_it);
+    auto *storex = dynamic_cast<CVM::StoreX *>(*store_it);
+    if (op->reg_idx1 != 1 || op->reg_idx2 != 2) return false;
+    if (storex == nullptr || storex->reg_idx != 1 || !storex->index.empty()) return false;
+    if (regLive(block, store_it, 2)) return false;
+    // PeepholeOptimization may have dropped a reload of the result, keep it in %1 then
+    const bool keep_result = regLive(block, store_it, 1);
+
+    auto *rhs         = *std::next(it);
+    const bool is_imm = rhs->opcode != CVM::Opcode::LOADX;
+    const auto first  = is_imm ? CVM::Opcode::ADDXI : CVM::Opcode::ADDXX;
+    auto *inst        = new CVM::ArithmeticX(
+        CVM::uchar2Opcode(CVM::opcode2UChar(first) + CVM::opcode2UChar(op->opcode) - CVM::opcode2UChar(CVM::Opcode::ADD)));
+    inst->dst  = storex->var;
+    inst->src1 = static_cast<CVM::LoadX *>(*it)->var;
+    setOperand(inst, rhs);
+    replace(block, it, 4, inst);
+    if (keep_result)
+    {
+        auto *loadx    = new CVM::LoadX;
+        loadx->reg_idx = 1;
+        loadx->var     = inst->dst;
+        it             = std::next(block->vm_insts.insert(it, loadx));
+    }
+    return true;
+}
+
+bool COMPILER::SuperInstruction::fuseCmpJmp(BytecodeBasicBlock *block, const std::string &next_block, InstIter &it)
+{
+    if (!matchOperands(block, it)) return false;
+    const auto cmp_it = std::next(it, 2);
+    const auto jif_it = std::next(cmp_it);
+    if (cmp_it == block->vm_insts.end() || jif_it == block->vm_insts.end()) return false;
+    if (!inOr((*cmp_it)->opcode, CVM::Opcode::NE, CVM::Opcode::EQ, CVM::Opcode::LT, CVM::Opcode::LE, CVM::Opcode::GT,
+              CVM::Opcode::GE))
+        return false;
+    auto *cmp = static_cast<CVM::Binary *>(*cmp_it);
+    auto *jif = dynamic_cast<CVM::Jif *>(*jif_it);
+    if (cmp->reg_idx1 != 1 || cmp->reg_idx2 != 2) return false;
+    // JIF ends the block, so no register outlives it
+    if (jif == nullptr || std::next(jif_it) != block->vm_insts.end()) return false;
+    if (jif->basic_block_name1 != next_block || jif->basic_block_name2 == next_block) return false;
+
+    auto *rhs         = *std::next(it);
+    const bool is_imm = rhs->opcode != CVM::Opcode::LOADX;
+    const auto first  = is_imm ? CVM::Opcode::JNEXI : CVM::Opcode::JNEXX;
+    auto *inst        = new CVM::CmpJmp(
+        CVM::uchar2Opcode(CVM::opcode2UChar(first) + CVM::opcode2UChar(cmp->opcode) - CVM::opcode2UChar(CVM::Opcode::NE)));
+    inst->src1             = static_cast<CVM::LoadX *>(*it)->var;
+    inst->basic_block_name = jif->basic_block_name2;
+    setOperand(inst, rhs);
+    replace(block, it, 4, inst);
+    return true;
+}
+
+bool COMPILER::SuperInstruction::fuseMove(BytecodeBasicBlock *block, InstIter &it)
+{
+    auto *loadx = dynamic_cast<CVM::LoadX *>(*it);
+    if (loadx == nullptr || loadx->reg_idx != 1 || !loadx->index.empty()) return false;
+    const auto store_it = std::next(it);
+    if (store_it == block->vm_insts.end()) return false;
+    auto *storex = dynamic_cast<CVM::StoreX *>(*store_it);
+    if (storex == nullptr || storex->reg_idx != 1 || !storex->index.empty()) return false;
+    if (regLive(block, store_it, 1)) return false;
+
+    auto *inst = new CVM::MovX;
+    inst->dst  = storex->var;
+    inst->src  = loadx->var;
+    replace(block, it, 2, inst);
+    return true;
+}
+
+bool COMPILER::SuperInstruction::matchOperands(BytecodeBasicBlock *block, InstIter it)
+{
+    auto isVar = [](CVM::VMInstruction *inst, int reg_idx)
+    {
+        auto *loadx = dynamic_cast<CVM::LoadX *>(inst);
+        return loadx != nullptr && loadx->reg_idx == reg_idx && loadx->index.empty();
+    };
+    if (!isVar(*it, 1) || ++it == block->vm_insts.end()) return false;
+    if (isVar(*it, 2)) return true;
+    if (!inOr((*it)->opcode, CVM::Opcode::LOADI, CVM::Opcode::LOADD)) return false;
+    return static_cast<CVM::Load *>(*it)->reg_idx == 2;
+}
+
+template<typename T>
+void COMPILER::SuperInstruction::setOperand(T *inst, CVM::VMInstruction *rhs)
+{
+    if (rhs->opcode == CVM::Opcode::LOADX)
+        inst->src2 = static_cast<CVM::LoadX *>(rhs)->var;
+    else if (rhs->opcode == CVM::Opcode::LOADI)
+        inst->imm = CYX::Value(static_cast<CVM::LoadI *>(rhs)->val);
+    else
+        inst->imm = CYX::Value(static_cast<CVM::LoadD *>(rhs)->val);
+}
+
+bool COMPILER::SuperInstruction::regLive(BytecodeBasicBlock *block, InstIter it, int reg_idx)
+{
+    for (++it; it != block->vm_insts.end(); it++)
+    {
+        auto *inst = *it;
+        switch (inst->opcode)
+        {
+            case CVM::Opcode::LOADI:
+            case CVM::Opcode::LOADD:
+            case CVM::Opcode::LOADS:
+            case CVM::Opcode::LOADA:
+            case CVM::Opcode::LOADX:
+                if (static_cast<CVM::Load *>(inst)->reg_idx == reg_idx) return false;
+                break;
+            case CVM::Opcode::LOADXA:
+                if (static_cast<CVM::Load *>(inst)->reg_idx == reg_idx) return true;
+                break;
+            case CVM::Opcode::STOREX:
+                if (static_cast<CVM::StoreX *>(inst)->reg_idx == reg_idx) return true;
+                break;
+            case CVM::Opcode::LNOT:
+            case CVM::Opcode::BNOT:
+                if (static_cast<CVM::Unary *>(inst)->reg_idx == reg_idx) return true;
+                break;
+            // the result of a call is written to %1, and the return value is passed back in it
+            case CVM::Opcode::CALL:
+                if (reg_idx == 1) return false;
+                break;
+            // the frame is gone
+            case CVM::Opcode::TAILCALL: return false;
+            case CVM::Opcode::RET:
+                if (reg_idx == 1) return true;
+                break;
+            case CVM::Opcode::JIF:
+                if (reg_idx == STATE_REGISTER) return true;
+                break;
+            default:
+            {
+                auto *binary = dynamic_cast<CVM::Binary *>(inst);
+                if (binary != nullptr && (binary->reg_idx1 == reg_idx || binary->reg_idx2 == reg_idx)) return true;
+                break;
+            }
+        }
+    }
+    return false;
+}
+
+void COMPILER::SuperInstruction::replace(BytecodeBasicBlock *block, InstIter &it, int count, CVM::VMInstruction *inst)
+{
+    for (int i = 0; i < count; i++)
+    {
+        delete *it;
+        it = block->vm_insts.erase(it);
+    }
+    it = std::next(block->vm_insts.insert(it, inst));
+}
@@ -0,0 +1,47 @@
+#ifndef CYX2_SUPERINSTRUCTION_H
+#define CYX2_SUPERINSTRUCTION_H
+
+#include "../../common/config.h"
+#include "../../core/opcode.hpp"
+#include "../../core/vm_instruction.hpp"
+#include "../../utility/utility.hpp"
+#include "bytecode_basicblock.hpp"
+
+#include <list>
+#include <string>
+#include <vector>
+
+namespace COMPILER
+{
+    // fuse the dominant sequences of one statement into one instruction, runs after PeepholeOptimization
+    //
+    // LOADX %1 a; LOADX %2 b; op %1 %2; STOREX c %1  ->  <op>XX c a b
+    // LOADX %1 a; LOADI %2 1; op %1 %2; STOREX c %1  ->  <op>XI c a 1
+    // LOADX %1 a; LOADX %2 b; cmp %1 %2; JIF t f     ->  J<cmp>XX a b f (t is the next block)
+    // LOADX %1 a; STOREX b %1                        ->  MOVX b a
+    class SuperInstruction
+    {
+        using InstIter = std::list<CVM::VMInstruction *>::iterator;
+
+      public:
+        void doSuperInstruction();
+
+      public:
+        std::vector<BytecodeBasicBlock *> *block_list;
+
+      private:
+        bool fuseArithmetic(BytecodeBasicBlock *block, InstIter &it);
+        bool fuseCmpJmp(BytecodeBasicBlock *block, const std::string &next_block, InstIter &it);
+        bool fuseMove(BytecodeBasicBlock *block, InstIter &it);
+        // LOADX %1 var; LOADX %2 var or LOADI/LOADD %2 imm
+        bool matchOperands(BytecodeBasicBlock *block, InstIter it);
+        template<typename T>
+        void setOperand(T *inst, CVM::VMInstruction *rhs);
+        // whether `reg_idx` is read after `it`(exclusive) before it is overwritten, registers never live across blocks
+        bool regLive(BytecodeBasicBlock *block, InstIter it, int reg_idx);
+        // replace `count` instructions from `it` with `inst`, `it` points at the one after `inst`
+        void replace(BytecodeBasicBlock *block, InstIter &it, int count, CVM::VMInstruction *inst);
+    };
+} // namespace COMPILER
+
+#endif // CYX2_SUPERINSTRUCTION_H
@@ -12,23 +12,11 @@ namespace COMPILER
     class IRInst;
     class IRAssign;
     class IRVar;
-    static int BASIC_BLOCK_COUNT = 0;
     class BasicBlock
     {
       public:
-        explicit BasicBlock() : name("cfg_auto_gen_"), block_index(BASIC_BLOCK_COUNT++){};
-        explicit BasicBlock(const std::string &name)
-        {
-            if (name.empty())
-            {
-                BasicBlock();
-            }
-            else
-            {
-                this->name  = name;
-                block_index = BASIC_BLOCK_COUNT++;
-            }
-        };
+        explicit BasicBlock() : name("cfg_auto_gen_"){};
+        explicit BasicBlock(const std::string &name) : name(name.empty() ? "cfg_auto_gen_" : name){};
         //
         void addInst(IRInst *instruction)
         {
@@ -70,7 +58,7 @@ namespace COMPILER
 
       public:
         std::string name;
-        int block_index;
+        int id{ -1 }; // position in its function, numbered by DominatorTree
         //
         std::list<IRInst *> insts; // ɾ 
         std::list<IRAssign *> phis; // phi Լ  
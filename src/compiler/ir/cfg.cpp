@@ -1,143 +1,5 @@
 #include "cfg.h"
 
-void COMPILER::CFG::init(IRFunction *func)
-{
-    for (auto block : func->blocks)
-    {
-        sdom[block]             = block;
-        disjoint_set[block]     = block;
-        disjoint_set_val[block] = block;
-    }
-}
-
-void COMPILER::CFG::clear()
-{
-    sdom.clear();
-    dfn.clear();
-    dfn_map.clear();
-    father.clear();
-    visited.clear();
-    sdom.clear();
-    idom.clear();
-    tree.clear();
-    dominance_frontier.clear();
-    disjoint_set.clear();
-    disjoint_set_val.clear();
-    var_block_map.clear();
-    counter.clear();
-    stack.clear();
-    ssa_def_map.clear();
-}
-
-void COMPILER::CFG::dfs(COMPILER::BasicBlock *cur_basic_block)
-{
-    if (cur_basic_block == nullptr) 
-        return;
-    if (visited.find(cur_basic_block) != visited.end()) 
-        return; // ̹ 湮 .
-    visited[cur_basic_block] = true;
-    dfn.push_back(cur_basic_block);
-    dfn_map[cur_basic_block] = dfn.size() - 1; // BB  ο
-    for (auto *block : cur_basic_block->succs)
-    {
-        dfs(block);
-        father[block] = cur_basic_block;
-    }
-}
-
-COMPILER::BasicBlock *COMPILER::CFG::find(COMPILER::BasicBlock *block)
-{ //    block ּҰ dfnum  ã
-    if (block == disjoint_set[block]) 
-      return block; 
-
-    // disjoint_set  key  value     ͸ ݺ.
-    auto *tmp = find(disjoint_set[block]);
-    
-    if (dfn_map[sdom[disjoint_set_val[disjoint_set[block]]]] < 
-        dfn_map[sdom[disjoint_set_val[block]]])
-        disjoint_set_val[block] = disjoint_set_val[disjoint_set[block]];
-
-    disjoint_set[block] = tmp;
-    return tmp;
-}
-
-void COMPILER::CFG::tarjan()
-{
-    for (unsigned long i = dfn.size() - 1; i >= 1; i--)
-    { // BB  ȸ
-        auto *cur_block = dfn[i];
-        if (cur_block == nullptr) 
-          continue;
-
-        for (auto *pre_block : cur_block->pres)
-        {
-            if (dfn_map.find(pre_block) != dfn_map.end())
-            {
-                find(cur_block);
-                //    dfnum
-                int a = dfn_map[sdom[cur_block]];
-                // ??
-                int b = dfn_map[sdom[disjoint_set_val[pre_block]]];
-                // ϴ sdom  cur_block   
-                // dfnum     .
-                sdom[cur_block] = dfn[std::min(a, b)];
-            }
-        }
-        
-        //  踦 ޴    
-        tree[sdom[cur_block]].insert(cur_block);
-        //   θ .
-        disjoint_set[cur_block] = father[cur_block];
-        // tmp   θ 
-        auto *tmp = disjoint_set[cur_block];
-        
-        for (auto *block : tree[tmp])
-        { // block  tmp  ޴  .
-            find(block);
-            if (dfn_map[sdom[disjoint_set_val[block]]] < 
-                dfn_map[father[cur_block]])
-                idom[block] = disjoint_set_val[block];
-            else
-                idom[block] = father[cur_block];
-        }
-        tree[tmp].clear();
-    }
-
-    for (int i = 1; i < dfn.size(); i++)
-    {
-        auto *cur_block = dfn[i];
-        if (idom[cur_block] != sdom[cur_block]) 
-          idom[cur_block] = idom[idom[cur_block]];
-        tree[idom[cur_block]].insert(cur_block);
-    }
-}
-
-void COMPILER::CFG::buildDominateTree(COMPILER::IRFunction *func)
-{
-    clear();
-    init(func);
-    dfs(func->blocks.front());
-    tarjan();
-    calcDominanceFrontier(func);
-}
-
-void COMPILER::CFG::calcDominanceFrontier(COMPILER::IRFunction *func)
-{
-    for (auto *block : func->blocks)
-    {
-        if (block->pres.size() < 2) continue;
-        for (auto *pre : block->pres)
-        {
-            auto *runner = pre;
-            while (runner != idom[block] && runner != nullptr)
-            {
-                dominance_frontier[runner].insert(block);
-                runner = idom[runner];
-            }
-        }
-    }
-}
-
 void COMPILER::CFG::simplifyCFG()
 {
     for (auto *func : funcs)
@@ -245,33 +107,64 @@ void COMPILER::CFG::removeUnusedPhis(IRFunction *func)
     }
 }
 
+// a function only touches its own IR here, calls refer to other functions by pointer and are not followed.
+// literals are separate values per IRConstant, so the reference counts of CYX::Value are never shared between threads
 void COMPILER::CFG::transformToSSA()
 {
-    if (NO_SSA) return;
-    for (auto *func : funcs)
-    {
-        if (func->blocks.empty()) continue;
-        entry = func->blocks.front();
-        buildDominateTree(func);
+    if (options.no_ssa || funcs.empty()) return;
+    const int cores   = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    const int threads = options.compile_threads > 0 ? options.compile_threads : cores;
+    ThreadPool pool(std::min<int>(threads, funcs.size()));
+    pool.run(funcs.size(), [this](size_t i) { transformToSSA(funcs[i]); });
+}
 
-        var_block_map.clear();
-        collectVarAssign(func);
-        insertPhiNode();
-        tryRename(func);
+void COMPILER::CFG::transformToSSA(IRFunction *func)
+{
+    if (func->blocks.empty()) return;
+    SSAContext ctx;
+    ctx.dom_tree.build(func);
+    collectVarAssign(ctx, func);
+    if (options.ssa_form != SSAForm::MINIMAL) computeLiveness(ctx, func);
+    insertPhiNode(ctx);
+    tryRename(ctx, func);
+    removeUnusedPhis(func);
+    removeTrivialPhi(func);
+    if (options.constant_folding)
+    {
+        sparseConditionalConstantPropagation(ctx, func);
         removeUnusedPhis(func);
-        removeTrivialPhi(func);
-        if (CONSTANT_FOLDING)
+    }
+    if (options.global_value_numbering)
+    {
+        if (options.constant_folding) ctx.dom_tree.build(func); // unreachable blocks are gone
+        globalValueNumbering(ctx, func);
+    }
+    phiElimination(func);
+    if (options.dead_code_elimination) deadCodeElimination(func);
+}
+
+// `t = f(...)` right before `return t`, f takes over the frame and returns for the caller.
+// only compiler temporaries, a named variable may be a global the caller has to write
+void COMPILER::CFG::markTailCalls()
+{
+    for (auto *func : funcs)
+    {
+        for (auto *block : func->blocks)
         {
-            constantFolding(func);
-            if (CONSTANT_PROPAGATION) constantPropagation(func);
-            removeUnusedPhis(func);
+            if (block->insts.size() < 2) continue;
+            auto *ret    = as<IRReturn, IR::Tag::RETURN>(block->insts.back());
+            auto *assign = as<IRAssign, IR::Tag::ASSIGN>(*std::prev(block->insts.end(), 2));
+            if (ret == nullptr || assign == nullptr) continue;
+            auto *call = as<IRCall, IR::Tag::CALL>(assign->src());
+            auto *var  = as<IRVar, IR::Tag::VAR>(ret->ret);
+            if (call == nullptr || call->func == nullptr || var == nullptr) continue;
+            if (!assign->dest()->is_ir_gen || !assign->dest()->index.empty() || !var->index.empty()) continue;
+            if (var->ssaName() == assign->dest()->ssaName()) call->tail = true;
         }
-        phiElimination(func);
-        if (DEAD_CODE_ELIMINATION) deadCodeElimination(func);
     }
 }
 
-void COMPILER::CFG::collectVarAssign(COMPILER::IRFunction *func)
+void COMPILER::CFG::collectVarAssign(SSAContext &ctx, COMPILER::IRFunction *func)
 {
     for (auto *block : func->blocks)
     {
@@ -281,49 +174,114 @@ void COMPILER::CFG::collectVarAssign(COMPILER::IRFunction *func)
             {
                 auto *assign = static_cast<IRAssign *>(inst);
                 if (assign->dest()->def == nullptr && assign->dest()->is_ir_gen) continue;
-                var_block_map[assign->dest()->name].insert(block);
+                if (assign->dest()->is_array) continue; // a[i] = x changes the array in place
+                ctx.var_block_map[assign->dest()->name].insert(block);
             }
         }
     }
 }
 
-void COMPILER::CFG::insertPhiNode()
+// live_in = gen + (live_out - kill), iterated until nothing changes
+void COMPILER::CFG::computeLiveness(SSAContext &ctx, COMPILER::IRFunction *func)
+{
+    for (auto *block : func->blocks)
+    {
+        block->gen.clear();
+        block->kill.clear();
+        block->live_in.clear();
+        block->live_out.clear();
+        for (auto *inst : block->insts)
+        {
+            forEachUse(inst, [&](IRVar *var) {
+                if (block->kill.count(var->name) == 0 && ctx.var_block_map.count(var->name) != 0)
+                    block->gen.insert(var->name);
+            });
+            auto *assign = as<IRAssign, IR::Tag::ASSIGN>(inst);
+            if (assign != nullptr && !assign->dest()->is_array) block->kill.insert(assign->dest()->name);
+        }
+        ctx.non_locals.insert(block->gen.begin(), block->gen.end());
+    }
+    if (options.ssa_form != SSAForm::PRUNED) return;
+
+    const auto &dom_tree = ctx.dom_tree;
+    // successors before predecessors, most blocks are final after the first pass
+    std::vector<int> work_list(dom_tree.postOrder().rbegin(), dom_tree.postOrder().rend());
+    std::vector<bool> queued(dom_tree.size(), false);
+    for (int id : work_list)
+    {
+        queued[id] = true;
+    }
+    while (!work_list.empty())
+    {
+        const int id = work_list.back();
+        work_list.pop_back();
+        queued[id]  = false;
+        auto *block = dom_tree.block(id);
+        for (int succ : dom_tree.succs(id))
+        {
+            const auto &succ_live_in = dom_tree.block(succ)->live_in;
+            block->live_out.insert(succ_live_in.begin(), succ_live_in.end());
+        }
+        auto live_in = block->gen;
+        for (const auto &name : block->live_out)
+        {
+            if (block->kill.count(name) == 0) live_in.insert(name);
+        }
+        // the sets only grow
+        if (live_in.size() == block->live_in.size()) continue;
+        block->live_in = std::move(live_in);
+        for (int pre : dom_tree.preds(id))
+        {
+            if (!dom_tree.reachable(pre) || queued[pre]) continue;
+            queued[pre] = true;
+            work_list.push_back(pre);
+        }
+    }
+}
+
+void COMPILER::CFG::insertPhiNode(SSAContext &ctx)
 {
-    std::queue<BasicBlock *> work_list;
-    std::unordered_map<BasicBlock *, std::string> inserted;
+    const auto &dom_tree = ctx.dom_tree;
+    std::vector<int> work_list;
+    // variable that last got a phi in the block, by its position in var_block_map
+    std::vector<int> inserted(dom_tree.size(), -1);
+    int var_count = 0;
 
-    for (const auto &p : var_block_map)
+    for (const auto &p : ctx.var_block_map)
     {
         const std::string var_name = p.first;
+        const int var_idx          = var_count++;
+        if (options.ssa_form == SSAForm::SEMI_PRUNED && ctx.non_locals.count(var_name) == 0) continue;
         for (auto *block : p.second)
         {
-            work_list.push(block);
+            work_list.push_back(block->id);
         }
         while (!work_list.empty())
         {
-            auto *block = work_list.front();
-            work_list.pop();
+            const int block = work_list.back();
+            work_list.pop_back();
 
-            for (auto *df_block : dominance_frontier[block])
+            for (int df : dom_tree.frontier(block))
             {
-                if (inserted[df_block] != var_name)
-                {
-                    // add phi node
-                    inserted[df_block] = var_name;
-                    auto *assign       = new IRAssign;
-                    //
-                    auto *lhs = new IRVar;
-                    lhs->name = var_name;
-                    //
-                    auto *phi = new IRPhi;
-                    //
-                    assign->setDest(lhs);
-                    assign->setSrc(phi);
-                    assign->block = df_block;
-                    df_block->phis.push_back(assign);
-                    // add block's dominance frontier to worklist
-                    work_list.push(df_block);
-                }
+                if (inserted[df] == var_idx) continue;
+                inserted[df]   = var_idx;
+                auto *df_block = dom_tree.block(df);
+                // no phi where the variable is dead, it would only be removed again
+                if (options.ssa_form == SSAForm::PRUNED && df_block->live_in.count(var_name) == 0) continue;
+                // add phi node
+                auto *assign = new IRAssign;
+                //
+                auto *lhs = new IRVar;
+                lhs->name = var_name;
+                //
+                auto *phi = new IRPhi;
+                //
+                assign->setDest(lhs);
+                assign->setSrc(phi);
+                assign->block = df_block;
+                df_block->phis.push_back(assign);
+                // add block's dominance frontier to worklist
+                work_list.push_back(df);
             }
         }
     }
@@ -349,20 +307,18 @@ void COMPILER::CFG::removeTrivialPhi(COMPILER::IRFunction *func)
                 auto *var = as<IRVar, IR::Tag::VAR>(tmp);
                 if (pre_idx == -1)
                 {
-                    pre_idx = var->ssa_index;
+                    pre_idx       = var->ssa_index;
+                    def           = var->def;
+                    def_ssa_index = var->ssa_index;
                     continue;
                 }
                 if (var->ssa_index == pre_idx)
-                {
                     same_idx_count++;
-                    def           = var->def;
-                    def_ssa_index = var->ssa_index;
-                }
                 else
                     break;
             }
-            // if found phi(x1, x1, x1, x1....), remove it~
-            if (same_idx_count == phi->args.size())
+            // if found phi(x1, x1, x1, x1....), remove it~. a phi of an undefined value stays
+            if (same_idx_count == phi->args.size() && def != nullptr)
             {
                 // replace uses to x1
                 for (auto use_it = assign->dest()->use.begin(); use_it != assign->dest()->use.end();)
@@ -384,161 +340,751 @@ void COMPILER::CFG::removeTrivialPhi(COMPILER::IRFunction *func)
     }
 }
 
-void COMPILER::CFG::constantPropagation(COMPILER::IRFunction *func)
+void COMPILER::CFG::sparseConditionalConstantPropagation(SSAContext &ctx, COMPILER::IRFunction *func)
 {
-    // constant propagation will be executed after constant folding.
-    // find some variables like following
-    // a1 = 1
-    // a3 = phi(a1, a2)
-    // -> a3 = phi(1, a2)
-    for (auto block : func->blocks)
+    using State          = LatticeCell::State;
+    const auto &dom_tree = ctx.dom_tree;
+    const int n          = dom_tree.size();
+    // the definitions and who reads them
+    std::unordered_map<IRVar *, LatticeCell> cells;
+    std::unordered_map<IRVar *, std::vector<std::pair<BasicBlock *, IRInst *>>> users;
+    for (auto *block : func->blocks)
     {
+        for (auto *phi : block->phis)
+        {
+            cells[phi->dest()];
+            for (auto *arg : as<IRPhi, IR::Tag::PHI>(phi->src())->args)
+            {
+                if (auto *var = as<IRVar, IR::Tag::VAR>(arg); var != nullptr && var->def != nullptr)
+                    users[var->def].emplace_back(block, phi);
+            }
+        }
+        for (auto *inst : block->insts)
+        {
+            forEachUse(inst, [&](IRVar *var) {
+                if (var->def != nullptr) users[var->def].emplace_back(block, inst);
+            });
+            auto *assign = as<IRAssign, IR::Tag::ASSIGN>(inst);
+            if (assign != nullptr && !assign->dest()->is_array) cells[assign->dest()];
+        }
+    }
+    for (auto *def : unstableDefs(func))
+    {
+        if (auto it = cells.find(def); it != cells.end()) it->second.state = State::OVERDEF;
+    }
+    // a call may store another value into a global
+    for (auto &[def, cell] : cells)
+    {
+        if (mayBeGlobal(def)) cell.state = State::OVERDEF;
+    }
+
+    // params, globals and array elements are unknown
+    auto valueOf = [&](IR *value) -> LatticeCell
+    {
+        if (auto *constant = as<IRConstant, IR::Tag::CONST>(value); constant != nullptr)
+            return { State::CONST, constant->value };
+        auto *var = as<IRVar, IR::Tag::VAR>(value);
+        if (var == nullptr || var->is_array || !var->index.empty() || var->def == nullptr || mayBeGlobal(var))
+            return { State::OVERDEF };
+        auto it = cells.find(var->def);
+        return it == cells.end() ? LatticeCell{ State::OVERDEF } : it->second;
+    };
+    auto meet = [](const LatticeCell &a, const LatticeCell &b) -> LatticeCell
+    {
+        if (a.state == State::UNDEF) return b;
+        if (b.state == State::UNDEF) return a;
+        if (a.state == State::CONST && b.state == State::CONST && a.value.isSameType(b.value) && a.value == b.value)
+            return a;
+        return { State::OVERDEF };
+    };
+
+    std::vector<bool> executable(n, false);
+    std::unordered_set<long long> edges; // pred * n + succ
+    auto isEdge = [&](BasicBlock *pred, BasicBlock *succ) { return edges.count(1LL * pred->id * n + succ->id) != 0; };
+    std::vector<std::pair<int, int>> flow_work{ { -1, 0 } };
+    std::vector<std::pair<BasicBlock *, IRInst *>> ssa_work;
+
+    auto lower = [&](IRVar *def, const LatticeCell &cell)
+    {
+        auto &cur = cells[def];
+        auto next = meet(cur, cell);
+        if (next.state == cur.state) return;
+        cur = std::move(next);
+        auto it = users.find(def);
+        if (it != users.end()) ssa_work.insert(ssa_work.end(), it->second.begin(), it->second.end());
+    };
+    auto visitPhi = [&](BasicBlock *block, IRAssign *assign)
+    {
+        auto *phi = as<IRPhi, IR::Tag::PHI>(assign->src());
+        LatticeCell cell;
+        for (int i = 0; i < phi->args.size(); i++)
+        {
+            if (isEdge(phi->blocks[i], block)) cell = meet(cell, valueOf(phi->args[i]));
+        }
+        lower(assign->dest(), cell);
+    };
+    // the successors it may go to are queued
+    auto visitInst = [&](BasicBlock *block, IRInst *inst)
+    {
+        if (auto *assign = as<IRAssign, IR::Tag::ASSIGN>(inst); assign != nullptr)
+        {
+            if (assign->dest()->is_array) return;
+            auto *src    = assign->src();
+            auto *binary = as<IRBinary, IR::Tag::BINARY>(src);
+            if (binary == nullptr)
+            {
+                lower(assign->dest(), inOr(src->tag, IR::Tag::CONST, IR::Tag::VAR) ? valueOf(src)
+                                                                                : LatticeCell{ State::OVERDEF });
+                return;
+            }
+            auto lhs = binary->lhs != nullptr ? valueOf(binary->lhs) : LatticeCell{ State::CONST };
+            auto rhs = valueOf(binary->rhs);
+            if (lhs.state == State::OVERDEF || rhs.state == State::OVERDEF)
+                lower(assign->dest(), { State::OVERDEF });
+            else if (lhs.state == State::CONST && rhs.state == State::CONST)
+            {
+                auto value = foldConstant(binary->opcode, binary->lhs != nullptr ? &lhs.value : nullptr, rhs.value);
+                lower(assign->dest(), value.has_value() ? LatticeCell{ State::CONST, value.value() }
+                                                        : LatticeCell{ State::OVERDEF });
+            }
+        }
+        else if (auto *branch = as<IRBranch, IR::Tag::BRANCH>(inst); branch != nullptr)
+        {
+            // a condition not known yet takes both sides, it can only be defined in a block not dominating the branch
+            auto cond = valueOf(branch->cond);
+            if (cond.state != State::CONST || static_cast<bool>(cond.value))
+                flow_work.emplace_back(block->id, branch->true_block->id);
+            if (cond.state != State::CONST || !static_cast<bool>(cond.value))
+                flow_work.emplace_back(block->id, branch->false_block->id);
+        }
+        else if (auto *jump = as<IRJump, IR::Tag::JMP>(inst); jump != nullptr)
+            flow_work.emplace_back(block->id, jump->target->id);
+    };
+
+    while (!flow_work.empty() || !ssa_work.empty())
+    {
+        while (!flow_work.empty())
+        {
+            const auto [from, to] = flow_work.back();
+            flow_work.pop_back();
+            if (from >= 0 && !edges.insert(1LL * from * n + to).second) continue;
+            auto *block = dom_tree.block(to);
+            for (auto *phi : block->phis)
+            {
+                visitPhi(block, phi);
+            }
+            if (executable[to]) continue;
+            executable[to] = true;
+            bool terminated = false;
+            for (auto *inst : block->insts)
+            {
+                visitInst(block, inst);
+                terminated = inOr(inst->tag, IR::Tag::JMP, IR::Tag::BRANCH, IR::Tag::RETURN);
+                if (terminated) break;
+            }
+            // falls through
+            if (!terminated)
+            {
+                for (int succ : dom_tree.succs(to))
+                {
+                    flow_work.emplace_back(to, succ);
+                }
+            }
+        }
+        while (!ssa_work.empty())
+        {
+            auto [block, inst] = ssa_work.back();
+            ssa_work.pop_back();
+            if (!executable[block->id]) continue;
+            auto *assign = as<IRAssign, IR::Tag::ASSIGN>(inst);
+            if (assign != nullptr && assign->src()->tag == IR::Tag::PHI)
+                visitPhi(block, assign);
+            else
+                visitInst(block, inst);
+        }
+    }
+
+    // rewrite the executable blocks
+    auto constantOf = [&](IRVar *var, IRInst *inst) -> IRConstant *
+    {
+        auto cell = valueOf(var);
+        if (cell.state != State::CONST) return nullptr;
+        auto *constant        = new IRConstant;
+        constant->value       = cell.value;
+        constant->belong_inst = inst;
+        return constant;
+    };
+    // a[i] -> a[1]
+    auto propagateIndex = [&](IRVar *var, IRInst *inst)
+    {
+        for (auto *&idx : var->index)
+        {
+            auto *idx_var = as<IRVar, IR::Tag::VAR>(idx);
+            if (idx_var == nullptr || !idx_var->index.empty()) continue;
+            if (auto *constant = constantOf(idx_var, inst); constant != nullptr)
+            {
+                forceRemoveVar(idx_var);
+                idx = constant;
+            }
+        }
+    };
+    auto propagate = [&](auto *&slot, IRInst *inst)
+    {
+        auto *var = as<IRVar, IR::Tag::VAR>(slot);
+        if (var == nullptr) return;
+        propagateIndex(var, inst);
+        if (!var->index.empty()) return;
+        if (auto *constant = constantOf(var, inst); constant != nullptr)
+        {
+            forceRemoveVar(var);
+            slot = constant;
+        }
+    };
+    auto propagateCall = [&](IRCall *call, IRInst *inst)
+    {
+        const int idx = findBuildin(call->name);
+        if (idx != 0 && buildinTable()[idx].converts_arg && call->args.size() == 1) return;
+        for (auto *&arg : call->args)
+        {
+            propagate(arg, inst);
+        }
+    };
+    for (auto *block : func->blocks)
+    {
+        if (!executable[block->id]) continue;
+        for (auto it = block->pres.begin(); it != block->pres.end();)
+        {
+            it = isEdge(*it, block) ? std::next(it) : block->pres.erase(it);
+        }
+        for (auto it = block->succs.begin(); it != block->succs.end();)
+        {
+            it = isEdge(block, *it) ? std::next(it) : block->succs.erase(it);
+        }
         for (auto *assign : block->phis)
         {
             auto *phi = as<IRPhi, IR::Tag::PHI>(assign->src());
-            for (auto &arg : phi->args)
-            {
-                auto *var        = as<IRVar, IR::Tag::VAR>(arg);
-                auto *arg_assign = as<IRAssign, IR::Tag::ASSIGN>(var->def->belong_inst);
-                if (arg_assign == nullptr) continue;
-                auto *constant = as<IRConstant, IR::Tag::CONST>(arg_assign->src());
-                if (constant == nullptr) continue;
-                // this is constant! propagate it!
-                var->def->killUse(var);
-                delete var;
-                // make a copy
-                auto *new_const        = new IRConstant;
-                new_const->value       = constant->value;
-                new_const->belong_inst = arg_assign;
-                //
-                arg = new_const;
+            for (int i = 0; i < phi->args.size();)
+            {
+                if (isEdge(phi->blocks[i], block))
+                {
+                    if (options.constant_propagation) propagate(phi->args[i], assign);
+                    i++;
+                    continue;
+                }
+                forceRemoveVar(as<IRVar, IR::Tag::VAR>(phi->args[i]));
+                phi->args.erase(phi->args.begin() + i);
+                phi->blocks.erase(phi->blocks.begin() + i);
+            }
+        }
+        for (auto it = block->insts.begin(); it != block->insts.end(); it++)
+        {
+            auto *inst = *it;
+            if (auto *assign = as<IRAssign, IR::Tag::ASSIGN>(inst); assign != nullptr)
+            {
+                auto *src = assign->src();
+                if (!assign->dest()->is_array && src->tag != IR::Tag::CONST)
+                {
+                    // fold
+                    if (auto *constant = constantOf(assign->dest(), assign); constant != nullptr)
+                    {
+                        const bool is_var = src->tag == IR::Tag::VAR;
+                        forEachUse(src, [](IRVar *var) { forceRemoveVar(var); });
+                        if (!is_var) delete src;
+                        assign->setSrc(constant);
+                        continue;
+                    }
+                }
+                if (!options.constant_propagation) continue;
+                propagateIndex(assign->dest(), assign);
+                if (auto *binary = as<IRBinary, IR::Tag::BINARY>(src); binary != nullptr)
+                {
+                    propagate(binary->lhs, assign);
+                    propagate(binary->rhs, assign);
+                }
+                else if (auto *var = as<IRVar, IR::Tag::VAR>(src); var != nullptr)
+                    propagateIndex(var, assign);
+                else if (auto *call = as<IRCall, IR::Tag::CALL>(src); call != nullptr)
+                    propagateCall(call, assign);
+                else if (auto *arr = as<IRArray, IR::Tag::ARRAY>(src); arr != nullptr)
+                {
+                    for (auto *&element : arr->content)
+                    {
+                        propagate(element, assign);
+                    }
+                }
+            }
+            else if (auto *call = as<IRCall, IR::Tag::CALL>(inst); call != nullptr)
+            {
+                if (options.constant_propagation) propagateCall(call, call);
+            }
+            else if (auto *ret = as<IRReturn, IR::Tag::RETURN>(inst); ret != nullptr)
+            {
+                if (options.constant_propagation) propagate(ret->ret, ret);
+            }
+            else if (auto *branch = as<IRBranch, IR::Tag::BRANCH>(inst); branch != nullptr)
+            {
+                // one side left
+                if (block->succs.size() == 1 && branch->true_block != branch->false_block)
+                {
+                    auto *jump   = new IRJump;
+                    jump->target = *block->succs.begin();
+                    jump->block  = block;
+                    forceRemoveVar(branch->cond);
+                    delete branch;
+                    *it = jump;
+                }
+            }
+            if (inOr((*it)->tag, IR::Tag::JMP, IR::Tag::BRANCH, IR::Tag::RETURN))
+            {
+                // nothing after the terminator runs
+                std::vector<IRInst *> dead(std::next(it), block->insts.end());
+                block->insts.erase(std::next(it), block->insts.end());
+                destroyInsts(dead, {});
+                break;
             }
         }
     }
+    // remove the blocks never reached, in one pass
+    std::vector<IRInst *> dead_insts;
+    std::vector<IRAssign *> dead_phis;
+    for (auto it = func->blocks.begin(); it != func->blocks.end();)
+    {
+        auto *block = *it;
+        if (executable[block->id])
+        {
+            it++;
+            continue;
+        }
+        dead_insts.insert(dead_insts.end(), block->insts.begin(), block->insts.end());
+        dead_phis.insert(dead_phis.end(), block->phis.begin(), block->phis.end());
+        it = func->blocks.erase(it);
+        delete block;
+    }
+    destroyInsts(dead_insts, dead_phis);
+}
+
+std::optional<CYX::Value> COMPILER::CFG::foldConstant(IROpcode opcode, const CYX::Value *lhs, const CYX::Value &rhs)
+{
+    // longest string `"ab" * n` is folded to
+    constexpr long long max_folded_string = 1024;
+    constexpr long long min_int           = std::numeric_limits<long long>::min();
+    using CYX::Value;
+    if (lhs == nullptr)
+    {
+        if (!rhs.is<long long>()) return {};
+        if (opcode == IR_LNOT) return !rhs;
+        if (opcode == IR_BNOT) return ~rhs;
+        return {};
+    }
+    const bool ints    = lhs->is<long long>() && rhs.is<long long>();
+    const bool numbers = !lhs->is<std::string>() && !rhs.is<std::string>();
+    const auto divisor = ints ? rhs.as<long long>() : 0;
+    switch (opcode)
+    {
+        case IR_ADD:
+        {
+            auto a = *lhs;
+            auto b = rhs;
+            return a + b;
+        }
+        case IR_SUB:
+            if (numbers) return *lhs - rhs;
+            break;
+        case IR_MUL:
+            if (numbers) return *lhs * rhs;
+            if (lhs->is<std::string>() && rhs.is<long long>() &&
+                lhs->as<std::string>().size() * std::max(0LL, rhs.as<long long>()) <= max_folded_string)
+                return *lhs * rhs;
+            if (rhs.is<std::string>() && lhs->is<long long>() &&
+                rhs.as<std::string>().size() * std::max(0LL, lhs->as<long long>()) <= max_folded_string)
+                return *lhs * rhs;
+            break;
+        case IR_DIV:
+            if (!numbers || rhs.as<double>() == 0) break;
+            if (ints && lhs->as<long long>() == min_int && divisor == -1) break;
+            return *lhs / rhs;
+        case IR_MOD:
+            if (ints && divisor != 0 && !(lhs->as<long long>() == min_int && divisor == -1)) return *lhs % rhs;
+            break;
+        case IR_BAND:
+            if (ints) return *lhs & rhs;
+            break;
+        case IR_BOR:
+            if (ints) return *lhs | rhs;
+            break;
+        case IR_BXOR:
+            if (ints) return *lhs ^ rhs;
+            break;
+        case IR_SHL:
+            if (ints && divisor >= 0 && divisor < 64 && lhs->as<long long>() >= 0) return *lhs << rhs;
+            break;
+        case IR_SHR:
+            if (ints && divisor >= 0 && divisor < 64) return *lhs >> rhs;
+            break;
+        case IR_EXP:
+            if (numbers) return lhs->power(rhs);
+            break;
+        case IR_LAND:
+            if (ints) return Value(*lhs && rhs);
+            break;
+        case IR_LOR:
+            if (ints) return Value(*lhs || rhs);
+            break;
+        case IR_EQ: return Value(*lhs == rhs);
+        case IR_NE: return Value(*lhs != rhs);
+        case IR_LE: return Value(*lhs <= rhs);
+        case IR_LT: return Value(*lhs < rhs);
+        case IR_GE: return Value(*lhs >= rhs);
+        case IR_GT: return Value(*lhs > rhs);
+        default: break;
+    }
+    return {};
 }
 
-void COMPILER::CFG::constantFolding(COMPILER::IRFunction *func)
+// reads leave their def-use chains before any definition goes, a definition still read somewhere is unlinked from its
+// readers, so nothing is left pointing at a deleted variable
+std::unordered_set<COMPILER::IRVar *> COMPILER::CFG::unstableDefs(COMPILER::IRFunction *func)
 {
-    for (auto block : func->blocks)
+    std::unordered_set<IRVar *> unstable;
+    std::unordered_map<std::string, std::vector<IRVar *>> defs; // ssa name -> its definitions
+    for (auto *param : func->params)
     {
+        defs[param->ssaName()].push_back(param);
+    }
+    for (auto *block : func->blocks)
+    {
+        for (auto *phi : block->phis)
+        {
+            defs[phi->dest()->ssaName()].push_back(phi->dest());
+        }
         for (auto *inst : block->insts)
         {
             auto *assign = as<IRAssign, IR::Tag::ASSIGN>(inst);
+            auto *call   = as<IRCall, IR::Tag::CALL>(assign != nullptr ? assign->src() : inst);
+            if (call != nullptr && call->args.size() == 1)
+            {
+                const int idx = findBuildin(call->name);
+                auto *arg     = as<IRVar, IR::Tag::VAR>(call->args[0]);
+                if (idx != 0 && buildinTable()[idx].converts_arg && arg != nullptr && arg->def != nullptr)
+                    unstable.insert(arg->def);
+            }
             if (assign == nullptr) continue;
-            if (assign->src()->tag == IR::Tag::CONST) continue;
-            //
-            auto constant = tryFindConstant(assign->dest());
-            if (constant.has_value())
+            if (!assign->dest()->is_array)
+                defs[assign->dest()->ssaName()].push_back(assign->dest());
+            else if (assign->dest()->def != nullptr)
+                unstable.insert(assign->dest()->def);
+        }
+    }
+    for (const auto &[name, vars] : defs)
+    {
+        if (vars.size() > 1) unstable.insert(vars.begin(), vars.end());
+    }
+    return unstable;
+}
+
+void COMPILER::CFG::globalValueNumbering(SSAContext &ctx, COMPILER::IRFunction *func)
+{
+    const auto &dom_tree = ctx.dom_tree;
+    const auto unstable  = unstableDefs(func);
+    std::unordered_map<std::string, int> numbers; // expression -> value number
+    std::unordered_map<IRVar *, int> var_numbers; // definition -> value number of what it holds
+    int next_number = 0;
+    // memory(array elements and globals) is read at a generation, every barrier starts a new one
+    int generation  = 0;
+    int generations = 0;
+    auto intern     = [&](const std::string &key)
+    {
+        auto [it, inserted] = numbers.emplace(key, next_number);
+        if (inserted) next_number++;
+        return it->second;
+    };
+    // -1 if equal reads of the value may differ
+    auto scalarNumber = [&](IR *value) -> int
+    {
+        if (auto *constant = as<IRConstant, IR::Tag::CONST>(value); constant != nullptr)
+        {
+            std::string key = "c" + std::to_string(static_cast<int>(constant->value.type())) + ":";
+            if (constant->value.is<double>())
             {
-                auto *result  = new IRConstant;
-                result->value = constant.value();
-                // free memory
-                auto *var = as<IRVar, IR::Tag ::VAR>(assign->src());
-                if (var != nullptr)
-                {
-                    var->def->killUse(var);
-                    delete var;
-                }
-                //
-                auto *binary = as<IRBinary, IR::Tag ::BINARY>(assign->src());
-                if (binary != nullptr)
+                const double d = constant->value.value<double>();
+                long long bits;
+                std::memcpy(&bits, &d, sizeof(bits));
+                return intern(key + std::to_string(bits));
+            }
+            return intern(key + constant->value.as<std::string>());
+        }
+        auto *var = as<IRVar, IR::Tag::VAR>(value);
+        if (var == nullptr || var->is_array || !var->index.empty()) return -1;
+        // a global, or a variable this function never assigns
+        if (var->def == nullptr)
+            return var->is_ir_gen ? -1 : intern("g" + var->name + "@" + std::to_string(generation));
+        if (unstable.count(var->def) != 0) return -1;
+        auto it = var_numbers.find(var->def);
+        if (it == var_numbers.end()) it = var_numbers.emplace(var->def, next_number++).first;
+        return it->second;
+    };
+    auto numberOf = [&](IR *value) -> int
+    {
+        auto *var = as<IRVar, IR::Tag::VAR>(value);
+        if (var == nullptr || !var->is_array) return scalarNumber(value);
+        if (var->is_ir_gen && (var->def == nullptr || unstable.count(var->def) != 0)) return -1;
+        std::string key = "m" + var->ssaName() + "@" + std::to_string(generation);
+        for (auto *idx : var->index)
+        {
+            const int number = scalarNumber(idx);
+            if (number < 0) return -1;
+            key += "," + std::to_string(number);
+        }
+        return intern(key);
+    };
+    auto binaryNumber = [&](IRBinary *binary) -> int
+    {
+        int lhs = binary->lhs == nullptr ? -2 : numberOf(binary->lhs);
+        int rhs = numberOf(binary->rhs);
+        if (lhs == -1 || rhs == -1) return -1;
+        // commutative whatever the operand types are
+        if (inOr(binary->opcode, IR_BAND, IR_BOR, IR_BXOR, IR_EQ, IR_NE) && lhs > rhs) std::swap(lhs, rhs);
+        return intern("b" + std::to_string(binary->opcode) + ":" + std::to_string(lhs) + ":" + std::to_string(rhs));
+    };
+
+    auto makeUse = [](IRVar *def, IRInst *inst)
+    {
+        auto *use        = new IRVar;
+        use->name        = def->name;
+        use->ssa_index   = def->ssa_index;
+        use->is_ir_gen   = def->is_ir_gen;
+        use->def         = def;
+        use->belong_inst = inst;
+        def->addUse(use);
+        return use;
+    };
+    auto drop = [](IR *value)
+    {
+        const bool is_var = value->tag == IR::Tag::VAR;
+        forEachUse(value, [](IRVar *var) {
+            if (var->def != nullptr) var->def->killUse(var);
+        });
+        forEachUse(value, [](IRVar *var) { delete var; });
+        if (!is_var) delete value;
+    };
+    // a global may be written by a call, its value can not be passed around
+    auto canHold = [&](IRVar *dest) { return !dest->is_array && !mayBeGlobal(dest) && unstable.count(dest) == 0; };
+
+    std::unordered_map<int, AvailableValue> available;
+    std::vector<int> scope; // numbers made available, forgotten when leaving the subtree
+    int temps = 0;
+    // the value is needed again, computed into a new temporary if no variable holds it yet
+    auto reuse = [&](int number) -> IRVar *
+    {
+        auto it = available.find(number);
+        if (it == available.end()) return nullptr;
+        auto &value = it->second;
+        if (value.leader != nullptr) return value.leader;
+        auto *temp      = new IRVar;
+        temp->name      = "gvn." + std::to_string(temps++);
+        temp->is_ir_gen = true;
+        auto *copy      = new IRAssign;
+        copy->block     = value.block;
+        copy->setDest(temp);
+        if (value.assign != nullptr)
+        {
+            copy->setSrc(value.assign->src());
+            value.assign->setSrc(makeUse(temp, value.assign));
+            value.block->addInstBefore(copy, value.assign);
+        }
+        else
+        {
+            auto *inst = value.binary->belong_inst;
+            copy->setSrc(*value.operand);
+            *value.operand = makeUse(temp, inst);
+            value.block->addInstBefore(copy, inst);
+        }
+        forEachUse(copy->src(), [&](IRVar *var) { var->belong_inst = copy; });
+        var_numbers[temp] = number;
+        value.leader      = temp;
+        return temp;
+    };
+    auto provide = [&](int number, const AvailableValue &value)
+    {
+        available.emplace(number, value);
+        scope.push_back(number);
+    };
+
+    std::unordered_map<IRVar *, IRVar *> replaced; // removed definition -> the variable holding its value
+    std::vector<IRInst *> dead;
+    auto visit = [&](BasicBlock *block)
+    {
+        for (auto it = block->insts.begin(); it != block->insts.end();)
+        {
+            auto *assign = as<IRAssign, IR::Tag::ASSIGN>(*it);
+            auto *call   = as<IRCall, IR::Tag::CALL>(assign != nullptr ? assign->src() : *it);
+            if (assign == nullptr)
+            {
+                if (call != nullptr) generation = ++generations;
+                it++;
+                continue;
+            }
+            auto *dest   = assign->dest();
+            auto *binary = as<IRBinary, IR::Tag::BINARY>(assign->src());
+            auto *var    = as<IRVar, IR::Tag::VAR>(assign->src());
+            int number   = -1;
+            if (binary != nullptr)
+            {
+                binary->belong_inst = assign;
+                for (auto **operand : { &binary->lhs, &binary->rhs })
                 {
-                    auto *lhs_const = as<IRConstant, IR::Tag::CONST>(binary->lhs);
-                    auto *lhs_var   = as<IRVar, IR::Tag::VAR>(binary->lhs);
-                    //
-                    auto *rhs_const = as<IRConstant, IR::Tag::CONST>(binary->rhs);
-                    auto *rhs_var   = as<IRVar, IR::Tag::VAR>(binary->rhs);
-                    // update ud-chains
-                    delete lhs_const;
-                    delete rhs_const;
-                    if (lhs_var != nullptr)
+                    auto *element = as<IRVar, IR::Tag::VAR>(*operand);
+                    if (element == nullptr || !element->is_array) continue;
+                    const int element_number = numberOf(element);
+                    if (element_number < 0) continue;
+                    if (auto *leader = reuse(element_number); leader != nullptr)
                     {
-                        lhs_var->def->killUse(lhs_var);
-                        delete lhs_var;
+                        drop(element);
+                        *operand = makeUse(leader, assign);
                     }
-                    if (rhs_var != nullptr)
+                    else
+                        provide(element_number, { nullptr, block, nullptr, binary, operand });
+                }
+                number = binaryNumber(binary);
+            }
+            else if (var != nullptr && var->is_array)
+                number = numberOf(var);
+            else if (var != nullptr && !dest->is_array && unstable.count(dest) == 0)
+            {
+                // a copy holds the same value
+                if (const int copied = scalarNumber(var); copied >= 0) var_numbers[dest] = copied;
+            }
+            if (number >= 0)
+            {
+                if (!dest->is_array && unstable.count(dest) == 0) var_numbers[dest] = number;
+                if (auto *leader = reuse(number); leader != nullptr)
+                {
+                    if (canHold(dest))
                     {
-                        rhs_var->def->killUse(rhs_var);
-                        delete rhs_var;
+                        replaced[dest] = leader;
+                        dead.push_back(assign);
+                        it = block->insts.erase(it);
+                        continue;
                     }
+                    drop(assign->src());
+                    assign->setSrc(makeUse(leader, assign));
                 }
-                // set new constant
-                assign->setSrc(result);
+                else if (canHold(dest))
+                    provide(number, { dest });
+                else
+                    provide(number, { nullptr, block, assign });
             }
+            if (call != nullptr || dest->is_array) generation = ++generations;
+            it++;
+        }
+    };
+
+    // dominator tree in preorder, a child continues from the memory of its parent only if it is the only way in
+    struct Frame
+    {
+        int block;
+        int next_child;
+        size_t scope_size;
+        int generation; // at the end of the block
+    };
+    std::vector<Frame> stack;
+    auto enter = [&](int block, int parent_generation)
+    {
+        generation = dom_tree.preds(block).size() == 1 ? parent_generation : ++generations;
+        const size_t scope_size = scope.size();
+        visit(dom_tree.block(block));
+        stack.push_back({ block, 0, scope_size, generation });
+    };
+    enter(0, -1);
+    while (!stack.empty())
+    {
+        auto &frame          = stack.back();
+        const auto &children = dom_tree.children(frame.block);
+        if (frame.next_child < children.size())
+        {
+            const int child = children[frame.next_child++];
+            enter(child, frame.generation);
+            continue;
+        }
+        while (scope.size() > frame.scope_size)
+        {
+            available.erase(scope.back());
+            scope.pop_back();
+        }
+        stack.pop_back();
+    }
+
+    // the uses of a removed definition read the earlier variable
+    if (replaced.empty()) return;
+    auto retarget = [&](IRVar *var)
+    {
+        auto it = var->def != nullptr ? replaced.find(var->def) : replaced.end();
+        if (it == replaced.end()) return;
+        auto *leader = it->second;
+        var->def->killUse(var);
+        var->def       = leader;
+        var->name      = leader->name;
+        var->ssa_index = leader->ssa_index;
+        var->is_ir_gen = leader->is_ir_gen;
+        leader->addUse(var);
+    };
+    for (auto *block : func->blocks)
+    {
+        for (auto *phi : block->phis)
+        {
+            for (auto *arg : as<IRPhi, IR::Tag::PHI>(phi->src())->args)
+            {
+                forEachUse(arg, retarget);
+            }
+        }
+        for (auto *inst : block->insts)
+        {
+            forEachUse(inst, retarget);
         }
     }
+    destroyInsts(dead, {});
 }
 
-std::optional<CYX::Value> COMPILER::CFG::tryFindConstant(COMPILER::IRVar *var)
+void COMPILER::CFG::destroyInsts(const std::vector<IRInst *> &insts, const std::vector<IRAssign *> &phis)
 {
-    // recursive exit
-    if (var == nullptr) return {};
-    auto *assign = as<IRAssign, IR::Tag::ASSIGN>(var->belong_inst);
-    if (assign == nullptr) return {};
-    // c = 1
-    // a = c
-    auto *src_var = as<IRVar, IR::Tag::VAR>(assign->src());
-    if (src_var != nullptr)
-    {
-        return tryFindConstant(src_var->def);
-    }
-    // a = 1
-    auto *src_constant = as<IRConstant, IR::Tag::CONST>(assign->src());
-    if (src_constant)
-    {
-        return src_constant->value;
-    }
-    // c = 1
-    // b = 1
-    // a = b + c
-    auto *src_binary = as<IRBinary, IR::Tag::BINARY>(assign->src());
-    if (src_binary && inOr(src_binary->opcode, IR_ADD, IR_SUB, IR_MUL, IR_DIV, IR_BOR, IR_BXOR, IR_MOD, IR_SHR, IR_SHL))
-    {
-        auto *lhs_const = as<IRConstant, IR::Tag::CONST>(src_binary->lhs);
-        auto *lhs_var   = as<IRVar, IR::Tag::VAR>(src_binary->lhs);
-        //
-        auto *rhs_const = as<IRConstant, IR::Tag::CONST>(src_binary->rhs);
-        auto *rhs_var   = as<IRVar, IR::Tag::VAR>(src_binary->rhs);
-        //
-        // recursive to find definitions. return null if found it not a constant.
-        //
-        CYX::Value lhs, rhs;
-        if (lhs_const != nullptr)
-            lhs = lhs_const->value;
-        else if (lhs_var != nullptr)
-        {
-            auto tmp = tryFindConstant(lhs_var->def);
-            if (tmp.has_value())
-                lhs = tmp.value();
-            else
-                return {};
-        }
-        //
-        if (rhs_const != nullptr)
-            rhs = rhs_const->value;
-        else if (rhs_var != nullptr)
+    auto unlink = [](IRVar *var)
+    {
+        if (var->def != nullptr) var->def->killUse(var);
+        var->def = nullptr;
+    };
+    for (auto *phi : phis)
+    {
+        for (auto *arg : as<IRPhi, IR::Tag::PHI>(phi->src())->args)
         {
-            auto tmp = tryFindConstant(rhs_var->def);
-            if (tmp.has_value())
-                rhs = tmp.value();
-            else
-                return {};
+            forEachUse(arg, unlink);
         }
-        switch (src_binary->opcode)
+    }
+    for (auto *inst : insts)
+    {
+        forEachUse(inst, unlink);
+    }
+    for (auto *phi : phis)
+    {
+        auto *src = as<IRPhi, IR::Tag::PHI>(phi->src());
+        for (auto *arg : src->args)
         {
-            case IR_ADD: return lhs + rhs;
-            case IR_SUB: return lhs - rhs;
-            case IR_MUL: return lhs * rhs;
-            case IR_DIV: return lhs / rhs;
-            case IR_BOR: return lhs | rhs;
-            case IR_BXOR: return lhs ^ rhs;
-            case IR_MOD: return lhs % rhs;
-            case IR_SHR: return lhs >> rhs;
-            case IR_SHL: return lhs << rhs;
-            default: UNREACHABLE();
+            delete arg;
         }
+        forceRemoveVar(phi->dest());
+        delete src;
+        delete phi;
+    }
+    for (auto *inst : insts)
+    {
+        auto *assign      = as<IRAssign, IR::Tag::ASSIGN>(inst);
+        auto *src         = assign != nullptr ? assign->src() : nullptr;
+        const bool is_var = src != nullptr && src->tag == IR::Tag::VAR;
+        const bool is_def = assign != nullptr && !assign->dest()->is_array;
+        forEachUse(inst, [](IRVar *var) { delete var; });
+        if (is_def) forceRemoveVar(assign->dest());
+        if (!is_var) delete src;
+        delete inst;
     }
-    return {};
 }
 
 void COMPILER::CFG::destroyPhiNode(COMPILER::IRAssign *assign)
@@ -557,17 +1103,20 @@ void COMPILER::CFG::destroyPhiNode(COMPILER::IRAssign *assign)
 
 void COMPILER::CFG::phiElimination(COMPILER::IRFunction *func)
 {
-    for (auto *block : func->blocks)
+    // copied, splitting an edge adds blocks
+    const std::vector<BasicBlock *> blocks(func->blocks.begin(), func->blocks.end());
+    for (auto *block : blocks)
     {
+        std::unordered_map<BasicBlock *, BasicBlock *> copy_blocks; // predecessor -> where its copies go
         for (auto *assign : block->phis)
         {
-            auto args = as<IRPhi, IR::Tag::PHI>(assign->src())->args;
+            auto *phi = as<IRPhi, IR::Tag::PHI>(assign->src());
 
             const auto dest_name    = assign->dest()->name;
             const auto dest_ssa_idx = assign->dest()->ssa_index;
             auto *dest              = assign->dest();
             //
-            for (int i = 0; i < args.size(); i++)
+            for (int i = 0; i < phi->args.size(); i++)
             {
                 auto *new_assign = new IRAssign;
                 if (i != 0)
@@ -584,28 +1133,17 @@ void COMPILER::CFG::phiElimination(COMPILER::IRFunction *func)
                     new_assign->setDest(dest);
                 }
                 //
-
-                BasicBlock *insert_block;
-                if (auto *tmp = as<IRVar, IR::Tag::VAR>(args[i]); tmp != nullptr)
-                {
-                    insert_block = tmp->def->belong_inst->block;
-                }
-                else if (auto *tmp = as<IRConstant, IR::Tag::CONST>(args[i]))
-                {
-                    insert_block = tmp->belong_inst->block;
-                }
-                else
-                {
-                    UNREACHABLE();
-                }
-                new_assign->setSrc(args[i]);
+                auto *pred = phi->blocks[i];
+                auto it    = copy_blocks.find(pred);
+                if (it == copy_blocks.end()) it = copy_blocks.emplace(pred, copyBlock(func, pred, block)).first;
+                auto *insert_block = it->second;
+                new_assign->setSrc(phi->args[i]);
                 new_assign->block = insert_block;
-                // avoid insert as following code
-                // jmp L1
-                // x1 = x2
-                if (insert_block->insts.back()->tag == IR::Tag::JMP)
+                // the copy is made on the edge, before the jump out of the predecessor
+                auto *last = insert_block->insts.empty() ? nullptr : insert_block->insts.back();
+                if (last != nullptr && (last->tag == IR::Tag::JMP || last->tag == IR::Tag::BRANCH))
                 {
-                    insert_block->addInstBefore(new_assign, insert_block->insts.back());
+                    insert_block->addInstBefore(new_assign, last);
                 }
                 else
                 {
@@ -619,6 +1157,35 @@ void COMPILER::CFG::phiElimination(COMPILER::IRFunction *func)
     }
 }
 
+// a predecessor with other successors gets a block of its own on the edge, so the copies do not run on the others
+COMPILER::BasicBlock *COMPILER::CFG::copyBlock(COMPILER::IRFunction *func, COMPILER::BasicBlock *pred,
+                                                COMPILER::BasicBlock *succ)
+{
+    if (pred->succs.size() <= 1) return pred;
+    auto *edge   = new BasicBlock(pred->name + "." + succ->name);
+    auto *jump   = new IRJump;
+    jump->target = succ;
+    jump->block  = edge;
+    edge->addInst(jump);
+    if (auto *branch = as<IRBranch, IR::Tag::BRANCH>(pred->insts.back()); branch != nullptr)
+    {
+        if (branch->true_block == succ) branch->true_block = edge;
+        if (branch->false_block == succ) branch->false_block = edge;
+    }
+    else
+    {
+        UNREACHABLE();
+    }
+    pred->succs.erase(succ);
+    pred->addSucc(edge);
+    succ->pres.erase(pred);
+    succ->addPre(edge);
+    edge->addPre(pred);
+    edge->addSucc(succ);
+    func->blocks.insert(std::next(std::find(func->blocks.begin(), func->blocks.end(), pred)), edge);
+    return edge;
+}
+
 void COMPILER::CFG::deadCodeElimination(COMPILER::IRFunction *func)
 {
     // MAGIC
@@ -631,7 +1198,9 @@ void COMPILER::CFG::deadCodeElimination(COMPILER::IRFunction *func)
             auto *assign = as<IRAssign, IR::Tag::ASSIGN>(tmp);
             // a = b + c
             // no user! remove this instruction!
-            if (assign != nullptr && assign->dest()->use.empty())
+            // an element store writes the array, not the name
+            if (assign != nullptr && !assign->dest()->is_array && !mayBeGlobal(assign->dest()) &&
+                assign->dest()->use.empty())
             {
                 if (assign->dest()->def != nullptr && assign->dest()->def->ssaName() == assign->dest()->ssaName())
                 {
@@ -648,22 +1217,22 @@ void COMPILER::CFG::deadCodeElimination(COMPILER::IRFunction *func)
                     inst_it++;
                     continue;
                 }
-                auto *var = as<IRVar, IR::Tag::VAR>(assign->src());
+                auto *var    = as<IRVar, IR::Tag::VAR>(assign->src());
+                auto *binary = as<IRBinary, IR::Tag::BINARY>(assign->src());
                 if (var != nullptr)
                 {
-                    var->def->killUse(var);
+                    if (var->def != nullptr) var->def->killUse(var);
                     delete var;
                 }
                 //
-                auto *binary = as<IRBinary, IR::Tag::BINARY>(assign->src());
                 if (binary != nullptr)
                 {
                     auto *lhs_var   = as<IRVar, IR::Tag::VAR>(binary->lhs);
                     auto *lhs_const = as<IRConstant, IR::Tag::CONST>(binary->lhs);
                     auto *rhs_var   = as<IRVar, IR::Tag::VAR>(binary->rhs);
                     auto *rhs_const = as<IRConstant, IR::Tag::CONST>(binary->rhs);
-                    if (lhs_var != nullptr) lhs_var->def->killUse(lhs_var);
-                    if (rhs_var != nullptr) rhs_var->def->killUse(rhs_var);
+                    if (lhs_var != nullptr && lhs_var->def != nullptr) lhs_var->def->killUse(lhs_var);
+                    if (rhs_var != nullptr && rhs_var->def != nullptr) rhs_var->def->killUse(rhs_var);
                     //
                     delete lhs_var;
                     delete rhs_var;
@@ -683,26 +1252,37 @@ void COMPILER::CFG::deadCodeElimination(COMPILER::IRFunction *func)
     }
 }
 
-void COMPILER::CFG::tryRename(COMPILER::IRFunction *func)
+void COMPILER::CFG::tryRename(SSAContext &ctx, COMPILER::IRFunction *func)
 {
-    for (const auto &p : var_block_map)
+    for (const auto &p : ctx.var_block_map)
     {
-        counter[p.first] = 0;
+        ctx.counter[p.first] = 0;
+    }
+    // params are defined on entry
+    for (auto *param : func->params)
+    {
+        param->ssa_index                  = newId(ctx, param->name, param);
+        ctx.ssa_def_map[param->ssaName()] = param;
+    }
+    rename(ctx, func->blocks.front());
+    for (auto *param : func->params)
+    {
+        ctx.stack[param->name].pop();
     }
-    rename(func->blocks.front());
 }
 
-void COMPILER::CFG::rename(COMPILER::BasicBlock *block)
+void COMPILER::CFG::rename(SSAContext &ctx, COMPILER::BasicBlock *block)
 {
     for (auto *phi : block->phis)
     {
-        auto *lhs                   = phi->dest();
-        lhs->ssa_index              = newId(lhs->name, lhs);
-        ssa_def_map[lhs->ssaName()] = lhs;
+        auto *lhs                       = phi->dest();
+        lhs->ssa_index                  = newId(ctx, lhs->name, lhs);
+        ctx.ssa_def_map[lhs->ssaName()] = lhs;
     }
+    std::vector<const std::string *> defined; // versions pushed by this block, popped when leaving it
     for (auto *inst : block->insts)
     {
-        renameIrArgs(inst);
+        if (renameIrArgs(ctx, inst)) defined.push_back(&static_cast<IRAssign *>(inst)->dest()->name);
     }
     for (auto *succ : block->succs)
     {
@@ -711,7 +1291,7 @@ void COMPILER::CFG::rename(COMPILER::BasicBlock *block)
             // add phi args
             auto *dest       = phi->dest();
             auto *src        = as<IRPhi, IR::Tag::PHI>(phi->src()); // real phi function
-            auto [id, def]   = getId(dest->name);
+            auto [id, def]   = getId(ctx, dest->name);
             auto *arg        = new IRVar;
             arg->ssa_index   = id;
             arg->name        = dest->name;
@@ -720,137 +1300,73 @@ void COMPILER::CFG::rename(COMPILER::BasicBlock *block)
             arg->def = dynamic_cast<IRVar *>(def);
             if (def != nullptr) def->addUse(arg);
             src->args.push_back(arg);
+            src->blocks.push_back(block);
         }
     }
-    for (auto *succ : tree[block])
+    for (int child : ctx.dom_tree.children(block->id))
     {
-        rename(succ);
+        rename(ctx, ctx.dom_tree.block(child));
     }
-    for (auto *inst : block->insts)
+    for (const auto *name : defined)
     {
-        if (inst->tag == IR::Tag::ASSIGN)
-        {
-            auto *assign = as<IRAssign, IR::Tag::ASSIGN>(inst);
-            if (!stack[assign->dest()->name].empty()) stack[assign->dest()->name].pop();
-        }
+        ctx.stack[*name].pop();
     }
     for (auto *phi : block->phis)
     {
-        if (!stack[phi->dest()->name].empty()) stack[phi->dest()->name].pop();
+        ctx.stack[phi->dest()->name].pop();
     }
 }
 
-void COMPILER::CFG::renameIrArgs(COMPILER::IR *inst)
+bool COMPILER::CFG::renameIrArgs(SSAContext &ctx, COMPILER::IR *inst)
 {
-    auto *func_call = as<IRCall, IR::Tag::CALL>(inst);
-    if (func_call != nullptr)
-    {
-        renameFuncCall(func_call);
-        return;
-    }
-    //
+    forEachUse(inst, [&](IRVar *var) { renameVar(ctx, var); });
     auto *assign = as<IRAssign, IR::Tag::ASSIGN>(inst);
-    auto *var    = as<IRVar, IR::Tag::VAR>(inst);
-    if (var != nullptr)
-    {
-        renameVar(var);
-        return;
-    }
-    if (assign == nullptr) return;
-    // try type cast
-    auto *binary = as<IRBinary, IR::Tag::BINARY>(assign->src());
-    var          = as<IRVar, IR::Tag::VAR>(assign->src());
-    func_call    = as<IRCall, IR::Tag ::CALL>(assign->src());
-    // rename src!
-    if (binary != nullptr)
-    {
-        auto *src_lhs = as<IRVar, IR::Tag::VAR>(binary->lhs);
-        auto *src_rhs = as<IRVar, IR::Tag::VAR>(binary->rhs);
-        renameVar(src_lhs);
-        renameVar(src_rhs);
-    }
-    if (var != nullptr)
-    {
-        renameVar(var);
-    }
-    if (func_call != nullptr)
-    {
-        renameFuncCall(func_call);
-    }
-    // rename dest
-    if (assign->dest()->def == nullptr && assign->dest()->is_ir_gen) return;
-    assign->dest()->ssa_index = newId(assign->dest()->name, assign->dest());
-    auto dest_name            = assign->dest()->ssaName();
-    ssa_def_map[dest_name]    = assign->dest();
+    if (assign == nullptr) return false;
+    // rename dest, a[i] = x is a use of a
+    if (assign->dest()->is_array) return false;
+    if (assign->dest()->def == nullptr && assign->dest()->is_ir_gen) return false;
+    assign->dest()->ssa_index  = newId(ctx, assign->dest()->name, assign->dest());
+    auto dest_name             = assign->dest()->ssaName();
+    ctx.ssa_def_map[dest_name] = assign->dest();
     assign->dest()->use.clear();
     assign->dest()->def = nullptr;
+    return true;
 }
 
-void COMPILER::CFG::renameFuncCall(COMPILER::IRCall *inst)
-{
-    for (auto *arg : inst->args)
-    {
-        renameIrArgs(arg);
-    }
-}
-
-void COMPILER::CFG::renameVar(COMPILER::IRVar *var)
+void COMPILER::CFG::renameVar(SSAContext &ctx, COMPILER::IRVar *var)
 {
     if (var == nullptr || var->is_ir_gen) return;
-    auto [id, def] = getId(var->name);
+    auto [id, def] = getId(ctx, var->name);
     var->ssa_index = id;
     // def-use chains update
     auto def_name = var->ssaName();
-    if (ssa_def_map.find(def_name) != ssa_def_map.end())
+    if (ctx.ssa_def_map.find(def_name) != ctx.ssa_def_map.end())
     {
-        var->def = ssa_def_map[def_name];
+        var->def = ctx.ssa_def_map[def_name];
         var->def->addUse(var);
     }
     else
-        UNREACHABLE();
+    {
+        // a global or a variable this function never assigns, its IR definition may be shared with other functions
+        var->def = nullptr;
+    }
 }
 
-int COMPILER::CFG::newId(const std::string &name, IRVar *def)
+int COMPILER::CFG::newId(SSAContext &ctx, const std::string &name, IRVar *def)
 {
-    int i = counter[name]++;
-    stack[name].push({ i, def });
+    int i = ctx.counter[name]++;
+    ctx.stack[name].push({ i, def });
     return i;
 }
 
-std::pair<int, COMPILER::IRVar *> COMPILER::CFG::getId(const std::string &name)
+std::pair<int, COMPILER::IRVar *> COMPILER::CFG::getId(SSAContext &ctx, const std::string &name)
 {
-    if (stack[name].empty()) return { 0, nullptr };
-    return stack[name].top();
+    if (ctx.stack[name].empty()) return { 0, nullptr };
+    return ctx.stack[name].top();
 }
 
 /////////////////////////dump as str//////////////////////
 
-std::string COMPILER::CFG::iDomDetailStr() const
-{
-    std::string str;
-    for (const auto &x : idom)
-    {
-        str += (x.first != nullptr ? x.first->name : "null") + " dominated by " +
-               (x.second != nullptr ? x.second->name : "null") + "\n";
-    }
-    return str;
-}
-
-std::string COMPILER::CFG::dominanceFrontierStr() const
-{
-    std::string str;
-    for (const auto &p : dominance_frontier)
-    {
-        str += p.first->name + " : {";
-        for (auto *block : p.second)
-        {
-            str += block->name + " ";
-        }
-        str += "}\n";
-    }
-    return str;
-}
-
 std::string COMPILER::CFG::cfgStr() const
 {
     std::string str = "digraph G{\n";
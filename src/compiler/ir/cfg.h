@@ -1,11 +1,18 @@
 #ifndef CVM_CFG_H
 #define CVM_CFG_H
 
+#include "../../common/buildin.hpp"
+#include "../../common/config.h"
+#include "../../utility/thread_pool.hpp"
 #include "../../utility/utility.hpp"
 #include "basicblock.hpp"
+#include "dominator_tree.h"
 #include "ir_instruction.hpp"
 
 #include <algorithm>
+#include <cstring>
+#include <limits>
+#include <optional>
 #include <queue>
 #include <stack>
 #include <unordered_map>
@@ -13,82 +20,109 @@
 
 namespace COMPILER
 {
+    // working state of SSA construction for one function, every function gets its own so they are transformed in
+    // parallel
+    struct SSAContext
+    {
+        DominatorTree dom_tree;
+        // SSA construction.....
+        std::unordered_map<std::string, std::unordered_set<BasicBlock *>> var_block_map;
+        // variables read before being defined in some block, the only ones semi-pruned SSA gives phis
+        std::unordered_set<std::string> non_locals;
+        std::unordered_map<std::string, int> counter;
+        std::unordered_map<std::string, std::stack<std::pair<int, IRVar *>>> stack;
+        // for build new def-use chain.
+        std::unordered_map<std::string, IRVar *> ssa_def_map;
+    };
+
+    // what sparse conditional constant propagation knows about one SSA variable, it only goes down:
+    // UNDEF(no definition reached yet) -> CONST -> OVERDEF(not a constant)
+    struct LatticeCell
+    {
+        enum class State
+        {
+            UNDEF,
+            CONST,
+            OVERDEF,
+        } state{ State::UNDEF };
+        CYX::Value value; // if CONST
+    };
+
+    // a value global value numbering has seen: the variable holding it, or where it is computed if no variable can be
+    // passed around. it is moved into a new temporary there the first time it is needed again
+    struct AvailableValue
+    {
+        IRVar *leader{ nullptr };
+        BasicBlock *block{ nullptr };
+        IRAssign *assign{ nullptr }; // `dest = value`
+        IRBinary *binary{ nullptr }; // or an array element read as an operand of `binary`
+        IRValue **operand{ nullptr };
+    };
+
     class CFG
     {
 
       public:
+        explicit CFG(const CompileOptions &options) : options(options)
+        {
+        }
         void simplifyCFG();
-        void buildDominateTree(COMPILER::IRFunction *func);
-        void transformToSSA(); // entry point
+        void transformToSSA(); // entry point, the functions are transformed on `options.compile_threads` threads
+        void markTailCalls();
         void removeUnusedPhis(IRFunction *func);
-        std::string iDomDetailStr() const;
-        std::string dominanceFrontierStr() const;
         std::string cfgStr() const;
 
       public:
         std::vector<IRFunction *> funcs;
 
       private:
-        void init(IRFunction *func);
-        void clear();
-        void dfs(BasicBlock *cur_basic_block);
-        // lengauer-tarjan algorithm 
-        void tarjan();
-        void calcDominanceFrontier(COMPILER::IRFunction *func);
-        // disjoint set
-        //    block ּҰ dfnum  ã
-        COMPILER::BasicBlock *find(COMPILER::BasicBlock *block);
+        void transformToSSA(IRFunction *func);
         // SSA construction
-        void collectVarAssign(COMPILER::IRFunction *func);
-        void insertPhiNode();
+        void collectVarAssign(SSAContext &ctx, COMPILER::IRFunction *func);
+        // gen/kill of every block for the variables in var_block_map, and their live_in/live_out if `options.ssa_form`
+        // is pruned
+        void computeLiveness(SSAContext &ctx, COMPILER::IRFunction *func);
+        void insertPhiNode(SSAContext &ctx);
         void removeTrivialPhi(COMPILER::IRFunction *func);
         //
-        void constantPropagation(COMPILER::IRFunction *func);
-        void constantFolding(COMPILER::IRFunction *func);
-        std::optional<CYX::Value> tryFindConstant(COMPILER::IRVar *var);
+        // sparse conditional constant propagation(Wegman-Zadeck) over SSA edges and executable CFG edges. constant
+        // definitions are folded, branches on a constant go to one side and the blocks no executable edge reaches are
+        // removed. with `options.constant_propagation` the reads of a constant become the constant itself
+        void sparseConditionalConstantPropagation(SSAContext &ctx, COMPILER::IRFunction *func);
+        // `lhs opcode rhs`, `lhs` is null for unary operators. empty if it is not known at compile time or would fail
+        // at runtime(a type error, dividing by zero ...)
+        static std::optional<CYX::Value> foldConstant(IROpcode opcode, const CYX::Value *lhs, const CYX::Value &rhs);
+        // binary expressions and array element reads computed again on a path of the dominator tree are replaced by
+        // the first result. calls and element stores are barriers for memory(array elements and globals)
+        void globalValueNumbering(SSAContext &ctx, COMPILER::IRFunction *func);
+        // definitions whose reads may see different values: a name defined more than once(temporaries of `&&` / `||`
+        // ...) is not in SSA form, and int(a) or a[i] = x change `a` behind its definition
+        static std::unordered_set<IRVar *> unstableDefs(COMPILER::IRFunction *func);
+        // a store to a global keeps the name, the first version of a named variable may be one
+        static bool mayBeGlobal(IRVar *var)
+        {
+            return !var->is_ir_gen && var->ssa_index == 0;
+        }
+        // frees instructions and phis taken out of the function
+        void destroyInsts(const std::vector<IRInst *> &insts, const std::vector<IRAssign *> &phis);
         //
         void destroyPhiNode(COMPILER::IRAssign *assign);
         // phi Լ , register allocation   ʰ  .
         void phiElimination(COMPILER::IRFunction *func);
+        // where the copies for the edge pred -> succ go, the edge is split if pred has other successors
+        BasicBlock *copyBlock(COMPILER::IRFunction *func, BasicBlock *pred, BasicBlock *succ);
         void deadCodeElimination(COMPILER::IRFunction *func);
         // rename
-        void tryRename(COMPILER::IRFunction *func);
-        void rename(BasicBlock *block);
-        void renameIrArgs(IR *inst);
-        void renameFuncCall(IRCall *inst);
-        void renameVar(IRVar *var);
-        int newId(const std::string &name, IRVar *def);
-        std::pair<int, IRVar *> getId(const std::string &name);
+        void tryRename(SSAContext &ctx, COMPILER::IRFunction *func);
+        void rename(SSAContext &ctx, BasicBlock *block);
+        // true if `inst` defines a new version
+        bool renameIrArgs(SSAContext &ctx, IR *inst);
+        void renameVar(SSAContext &ctx, IRVar *var);
+        int newId(SSAContext &ctx, const std::string &name, IRVar *def);
+        std::pair<int, IRVar *> getId(SSAContext &ctx, const std::string &name);
 
       private:
-        BasicBlock *entry{ nullptr };
-        // dfs related
-        //  켱 Ž dfnum 
-        std::vector<BasicBlock *> dfn;
-        // node dfnum ˻
-        std::unordered_map<BasicBlock *, int> dfn_map;
-        std::unordered_map<BasicBlock *, BasicBlock *> father;
-        std::unordered_map<BasicBlock *, bool> visited;
-        // dominate tree related
-        // <node,semidominator> : Ư  
-        std::unordered_map<BasicBlock *, BasicBlock *> sdom; // a.k.a semi, not strict.
-        // immediate dominator :  
-        std::unordered_map<BasicBlock *, BasicBlock *> idom; // the closest point of dominated point
-        //  . å bucket  
-        std::unordered_map<BasicBlock *, std::unordered_set<BasicBlock *>> tree;
-        // DF
-        std::unordered_map<BasicBlock *, std::unordered_set<BasicBlock *>> dominance_frontier;
-        // disjoint set (union find) related
-        // <node, father> :   θ 
-        std::unordered_map<BasicBlock *, BasicBlock *> disjoint_set;
-        // <node, > : θ θ??
-        std::unordered_map<BasicBlock *, BasicBlock *> disjoint_set_val;
-        // SSA construction.....
-        std::unordered_map<std::string, std::unordered_set<BasicBlock *>> var_block_map;
-        std::unordered_map<std::string, int> counter;
-        std::unordered_map<std::string, std::stack<std::pair<int, IRVar *>>> stack;
-        // for build new def-use chain.
-        std::unordered_map<std::string, IRVar *> ssa_def_map;
+        const CompileOptions options;
     };
 } // namespace COMPILER
 
@@ -0,0 +1,200 @@
+#include "dominator_tree.h"
+
+#include <algorithm>
+
+void COMPILER::DominatorTree::build(COMPILER::IRFunction *func)
+{
+    number(func);
+    lengauerTarjan();
+    walkTree();
+    calcDominanceFrontier();
+}
+
+void COMPILER::DominatorTree::number(COMPILER::IRFunction *func)
+{
+    blocks.assign(func->blocks.begin(), func->blocks.end());
+    const int n = blocks.size();
+    for (int i = 0; i < n; i++)
+    {
+        blocks[i]->id = i;
+    }
+    pred_ids.assign(n, {});
+    succ_ids.assign(n, {});
+    for (int i = 0; i < n; i++)
+    {
+        for (auto *pre : blocks[i]->pres)
+        {
+            pred_ids[i].push_back(pre->id);
+        }
+        for (auto *succ : blocks[i]->succs)
+        {
+            succ_ids[i].push_back(succ->id);
+        }
+        std::sort(pred_ids[i].begin(), pred_ids[i].end());
+        std::sort(succ_ids[i].begin(), succ_ids[i].end());
+    }
+}
+
+void COMPILER::DominatorTree::lengauerTarjan()
+{
+    const int n = blocks.size();
+    dfnum.assign(n, -1);
+    vertex.clear();
+    parent.clear();
+    idoms.assign(n, -1);
+    if (n == 0) return;
+    // dfs numbering of the CFG from the entry, an explicit stack since machine-generated CFGs get deep
+    std::vector<std::pair<int, int>> stack{ { 0, -1 } };
+    while (!stack.empty())
+    {
+        auto [block, from] = stack.back();
+        stack.pop_back();
+        if (dfnum[block] >= 0) continue;
+        dfnum[block] = vertex.size();
+        vertex.push_back(block);
+        parent.push_back(from);
+        for (auto it = succ_ids[block].rbegin(); it != succ_ids[block].rend(); it++)
+        {
+            if (dfnum[*it] < 0) stack.emplace_back(*it, dfnum[block]);
+        }
+    }
+    // from here on every index is a dfs number
+    const int count = vertex.size();
+    semi.resize(count);
+    label.resize(count);
+    ancestor.assign(count, -1);
+    std::vector<int> dom(count, 0);
+    std::vector<std::vector<int>> bucket(count);
+    for (int i = 0; i < count; i++)
+    {
+        semi[i]  = i;
+        label[i] = i;
+    }
+    for (int w = count - 1; w >= 1; w--)
+    {
+        for (int pre : pred_ids[vertex[w]])
+        {
+            if (dfnum[pre] < 0) continue;
+            const int u = eval(dfnum[pre]);
+            if (semi[u] < semi[w]) semi[w] = semi[u];
+        }
+        bucket[semi[w]].push_back(w);
+        const int p = parent[w];
+        ancestor[w] = p;
+        for (int v : bucket[p])
+        {
+            const int u = eval(v);
+            dom[v]      = semi[u] < semi[v] ? u : p;
+        }
+        bucket[p].clear();
+    }
+    for (int w = 1; w < count; w++)
+    {
+        if (dom[w] != semi[w]) dom[w] = dom[dom[w]];
+        idoms[vertex[w]] = vertex[dom[w]];
+    }
+}
+
+int COMPILER::DominatorTree::eval(int v)
+{
+    if (ancestor[v] < 0) return v;
+    compress(v);
+    return label[v];
+}
+
+void COMPILER::DominatorTree::compress(int v)
+{
+    path.clear();
+    for (int u = v; ancestor[ancestor[u]] >= 0; u = ancestor[u])
+    {
+        path.push_back(u);
+    }
+    // the node nearest to the root first, as the recursive version unwinds
+    for (auto it = path.rbegin(); it != path.rend(); it++)
+    {
+        const int u = *it;
+        const int a = ancestor[u];
+        if (semi[label[a]] < semi[label[u]]) label[u] = label[a];
+        ancestor[u] = ancestor[a];
+    }
+}
+
+void COMPILER::DominatorTree::walkTree()
+{
+    const int n = blocks.size();
+    tree.assign(n, {});
+    for (int i = 0; i < n; i++)
+    {
+        if (idoms[i] >= 0) tree[idoms[i]].push_back(i); // ascending, so the children are sorted
+    }
+    pre_order.clear();
+    post_order.clear();
+    pre_index.assign(n, -1);
+    post_index.assign(n, -1);
+    if (n == 0) return;
+    // (block, next child)
+    std::vector<std::pair<int, int>> stack{ { 0, 0 } };
+    pre_index[0] = 0;
+    pre_order.push_back(0);
+    while (!stack.empty())
+    {
+        auto &[block, next] = stack.back();
+        if (next < tree[block].size())
+        {
+            const int child  = tree[block][next++];
+            pre_index[child] = pre_order.size();
+            pre_order.push_back(child);
+            stack.emplace_back(child, 0);
+            continue;
+        }
+        post_index[block] = post_order.size();
+        post_order.push_back(block);
+        stack.pop_back();
+    }
+}
+
+// a join point is in the frontier of every block from its predecessors up to(excluding) its immediate dominator
+void COMPILER::DominatorTree::calcDominanceFrontier()
+{
+    const int n = blocks.size();
+    frontiers.assign(n, {});
+    for (int block = 0; block < n; block++)
+    {
+        if (!reachable(block) || pred_ids[block].size() < 2) continue;
+        for (int pre : pred_ids[block])
+        {
+            if (!reachable(pre)) continue;
+            for (int runner = pre; runner != idoms[block]; runner = idoms[runner])
+            {
+                // blocks are visited in order, a repeat can only be the last one
+                if (!frontiers[runner].empty() && frontiers[runner].back() == block) break;
+                frontiers[runner].push_back(block);
+            }
+        }
+    }
+}
+
+std::string COMPILER::DominatorTree::iDomDetailStr() const
+{
+    std::string str;
+    for (int i = 0; i < blocks.size(); i++)
+    {
+        str += blocks[i]->name + " dominated by " + (idoms[i] >= 0 ? blocks[idoms[i]]->name : "null") + "\n";
+    }
+    return str;
+}
+
+std::string COMPILER::DominatorTree::dominanceFrontierStr() const
+{
+    std::string str;
+    for (int i = 0; i < blocks.size(); i++)
+    {
+        str += blocks[i]->name + " : {";
+        for (int block : frontiers[i])
+        {
+            str += blocks[block]->name + " ";
+        }
+        str += "}\n";
+    }
+    return str;
+}
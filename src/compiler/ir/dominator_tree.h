@@ -0,0 +1,107 @@
+#ifndef CVM_DOMINATOR_TREE_H
+#define CVM_DOMINATOR_TREE_H
+
+#include "basicblock.hpp"
+#include "ir_instruction.hpp"
+
+#include <string>
+#include <vector>
+
+namespace COMPILER
+{
+    // dominator tree and dominance frontiers of one function.
+    //
+    // the blocks are numbered densely by their position in IRFunction::blocks(BasicBlock::id), every relation is a
+    // flat array indexed by that number and the adjacency lists are sorted, so the result does not depend on
+    // addresses. blocks not reachable from the entry have no dominator and are in no order.
+    class DominatorTree
+    {
+      public:
+        // numbers the blocks of `func` and computes everything, Lengauer-Tarjan with path compression
+        void build(IRFunction *func);
+        int size() const
+        {
+            return blocks.size();
+        }
+        BasicBlock *block(int id) const
+        {
+            return blocks[id];
+        }
+        bool reachable(int id) const
+        {
+            return pre_index[id] >= 0;
+        }
+        // -1 for the entry and unreachable blocks
+        int idom(int id) const
+        {
+            return idoms[id];
+        }
+        // a dominates b(a == b included), constant time by the pre/post order of the tree
+        bool dominates(int a, int b) const
+        {
+            return reachable(a) && reachable(b) && pre_index[a] <= pre_index[b] && post_index[b] <= post_index[a];
+        }
+        bool dominates(const BasicBlock *a, const BasicBlock *b) const
+        {
+            return dominates(a->id, b->id);
+        }
+        const std::vector<int> &children(int id) const
+        {
+            return tree[id];
+        }
+        const std::vector<int> &frontier(int id) const
+        {
+            return frontiers[id];
+        }
+        const std::vector<int> &preds(int id) const
+        {
+            return pred_ids[id];
+        }
+        const std::vector<int> &succs(int id) const
+        {
+            return succ_ids[id];
+        }
+        // reachable blocks in DFS order of the dominator tree, a block comes before(pre)/after(post) its subtree
+        const std::vector<int> &preOrder() const
+        {
+            return pre_order;
+        }
+        const std::vector<int> &postOrder() const
+        {
+            return post_order;
+        }
+        std::string iDomDetailStr() const;
+        std::string dominanceFrontierStr() const;
+
+      private:
+        void number(IRFunction *func);
+        void lengauerTarjan();
+        void walkTree();
+        void calcDominanceFrontier();
+        // min semidominator on the forest path of `v`, over dfs numbers
+        int eval(int v);
+        void compress(int v);
+
+      private:
+        std::vector<BasicBlock *> blocks;
+        std::vector<std::vector<int>> pred_ids;
+        std::vector<std::vector<int>> succ_ids;
+        std::vector<int> idoms;
+        std::vector<std::vector<int>> tree; // children in the dominator tree
+        std::vector<std::vector<int>> frontiers;
+        std::vector<int> pre_order;
+        std::vector<int> post_order;
+        std::vector<int> pre_index;  // position in pre_order, -1 if unreachable
+        std::vector<int> post_index; // position in post_order
+        // lengauer-tarjan, indexed by dfs number of the CFG
+        std::vector<int> dfnum;  // block -> dfs number, -1 if unreachable
+        std::vector<int> vertex; // dfs number -> block
+        std::vector<int> parent;
+        std::vector<int> semi;
+        std::vector<int> ancestor;
+        std::vector<int> label;
+        std::vector<int> path; // compress() without recursion
+    };
+} // namespace COMPILER
+
+#endif // CVM_DOMINATOR_TREE_H
@@ -277,9 +277,15 @@ void COMPILER::IRGenerator::visitFuncCallExpr(COMPILER::FuncCallExpr *ptr)
     auto *inst = new IRCall;
     inst->name = ptr->func_name;
 
-    bool is_buildin = buildin_functions.find("buildin_" + ptr->func_name) != buildin_functions.end();
+    const int buildin = findBuildin(ptr->func_name);
 
-    if (!is_buildin)
+    if (buildin != 0)
+    {
+        const auto &x = buildinTable()[buildin];
+        if (ptr->args.size() < x.min_argc || (x.max_argc != VARIADIC && ptr->args.size() > x.max_argc))
+            CERR("wrong number of arguments to `" + ptr->func_name + "` in " + POS(ptr));
+    }
+    else
     {
         inst->name += "#" + std::to_string(ptr->args.size());
         if (first_scan_funcs.find(inst->name) == first_scan_funcs.end())
@@ -697,7 +703,7 @@ COMPILER::IRVar *COMPILER::IRGenerator::consumeVariable(bool force_IRVar)
     return retval;
 }
 
-COMPILER::IRGenerator::IRGenerator()
+COMPILER::IRGenerator::IRGenerator(const CompileOptions &options) : options(options)
 {
     cur_symbol = new SymbolTable(global_table);
 }
@@ -827,7 +833,7 @@ void COMPILER::IRGenerator::visitTree(COMPILER::Tree *ptr)
         exitScope();
     }
 
-    if (!NO_CODE_SIMPLIFY) 
+    if (!options.no_code_simplify) 
       simplifyIR();
 
     fixEdges();
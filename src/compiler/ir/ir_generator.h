@@ -17,7 +17,7 @@ namespace COMPILER
     class IRGenerator : public ASTVisitor
     {
       public:
-        IRGenerator();
+        explicit IRGenerator(const CompileOptions &options);
         ~IRGenerator();
         void visitTree(Tree *ptr) override;
         std::string irStr();
@@ -74,6 +74,7 @@ namespace COMPILER
         std::vector<IRJump *> *cur_fix_continue_wait_list{ nullptr };
 
       private:
+        const CompileOptions options;
         int var_cnt{ 0 };
         int label_cnt{ 0 };
         SymbolTable global_table;
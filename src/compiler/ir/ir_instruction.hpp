@@ -309,6 +309,7 @@ namespace COMPILER
         std::string name;
         IRFunction *func{ nullptr };
         std::vector<IR *> args;
+        bool tail{ false }; // its result is returned right away, see CFG::markTailCalls
     };
 
     class IRArray : public IRValue
@@ -340,9 +341,10 @@ namespace COMPILER
         {
             tag = IR::Tag::VAR;
         }
+        // the first version keeps the name, so it reads the same with and without SSA. `.` is never in a name
         std::string ssaName()
         {
-            return NO_SSA || is_ir_gen ? name : name + std::to_string(ssa_index);
+            return is_ir_gen || ssa_index == 0 ? name : name + "." + std::to_string(ssa_index);
         }
         std::string toString() override
         {
@@ -356,7 +358,7 @@ namespace COMPILER
             }
             else
             {
-                str += (is_ir_gen || NO_SSA ? "" : std::to_string(ssa_index));
+                str += (is_ir_gen || ssa_index == 0 ? "" : "." + std::to_string(ssa_index));
             }
             return str;
         }
@@ -430,6 +432,7 @@ namespace COMPILER
         }
         // var / constant
         std::vector<IRValue *> args;
+        std::vector<BasicBlock *> blocks; // the predecessor each argument comes from
     };
 
     class IRAssign : public IRInst
@@ -522,6 +525,53 @@ namespace COMPILER
         }
     };
 
+    // every variable `ir` reads: operands, call arguments, array elements and indexes, the condition of a branch, the
+    // returned value, and the array(and its indexes) an element assignment `a[i] = x` writes into. phis are left out
+    template<typename F>
+    static void forEachUse(IR *ir, F &&f)
+    {
+        if (ir == nullptr) return;
+        switch (ir->tag)
+        {
+            case IR::Tag::VAR:
+            {
+                auto *var = static_cast<IRVar *>(ir);
+                for (auto *idx : var->index)
+                {
+                    forEachUse(idx, f);
+                }
+                f(var);
+                break;
+            }
+            case IR::Tag::BINARY:
+                forEachUse(static_cast<IRBinary *>(ir)->lhs, f);
+                forEachUse(static_cast<IRBinary *>(ir)->rhs, f);
+                break;
+            case IR::Tag::CALL:
+                for (auto *arg : static_cast<IRCall *>(ir)->args)
+                {
+                    forEachUse(arg, f);
+                }
+                break;
+            case IR::Tag::ARRAY:
+                for (auto *element : static_cast<IRArray *>(ir)->content)
+                {
+                    forEachUse(element, f);
+                }
+                break;
+            case IR::Tag::BRANCH: forEachUse(static_cast<IRBranch *>(ir)->cond, f); break;
+            case IR::Tag::RETURN: forEachUse(static_cast<IRReturn *>(ir)->ret, f); break;
+            case IR::Tag::ASSIGN:
+            {
+                auto *assign = static_cast<IRAssign *>(ir);
+                forEachUse(assign->src(), f);
+                if (assign->dest()->is_array) forEachUse(assign->dest(), f);
+                break;
+            }
+            default: break;
+        }
+    }
+
     static bool forceRemoveVar(IRVar *var)
     {
         if (var == nullptr) return false;
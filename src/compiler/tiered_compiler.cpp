@@ -0,0 +1,133 @@
+#include "tiered_compiler.h"
+
+COMPILER::TieredCompiler::TieredCompiler(std::string code, const CVM::Program &program,
+                                         const CompileOptions &options)
+    : code(std::move(code)), options(options)
+{
+    for (const auto &inst : program.code)
+    {
+        if (inst.opcode == CVM::Opcode::FUNC)
+            funcs_table.emplace(std::make_pair(program.names[inst.c], inst.a), &inst - program.code.data());
+    }
+    worker = std::thread(&TieredCompiler::work, this);
+}
+
+COMPILER::TieredCompiler::~TieredCompiler()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void COMPILER::TieredCompiler::request(int func, const std::string &name)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.emplace_back(func, name);
+    }
+    wake.notify_one();
+}
+
+bool COMPILER::TieredCompiler::poll(CVM::Recompiled &result)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (results.empty()) return false;
+    result = std::move(results.back());
+    results.pop_back();
+    finished.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+// one job at a time, the VM thread never waits for it
+void COMPILER::TieredCompiler::work()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        wake.wait(lock, [this]() { return stop || !jobs.empty(); });
+        if (stop) return;
+        const auto [func, name] = jobs.front();
+        jobs.pop_front();
+        lock.unlock();
+        CVM::Recompiled result;
+        result.func  = func;
+        result.insts = compile(name);
+        lock.lock();
+        if (result.insts.empty()) continue;
+        results.push_back(std::move(result));
+        finished.fetch_add(1, std::memory_order_release);
+    }
+}
+
+std::vector<CVM::VMInstruction *> COMPILER::TieredCompiler::compile(const std::string &name)
+{
+    if (!lowered)
+    {
+        Parser parser(code);
+        ir_generator.visitTree(parser.parse());
+        if (options.remove_unused_define) ir_generator.removeUnusedVarDef();
+        lowered = true;
+    }
+    CFG cfg(options);
+    for (auto *func : ir_generator.funcs)
+    {
+        if (func->name == name) cfg.funcs.push_back(func);
+    }
+    if (cfg.funcs.size() != 1) return {};
+    if (!options.no_cfg_simplify) cfg.simplifyCFG();
+    if (!options.no_ssa) cfg.transformToSSA();
+    if (!options.no_tail_call) cfg.markTailCalls();
+    // the global frame is laid out as in the running program, the declarations are only generated for its slots
+    BytecodeGenerator bytecode_generator(options);
+    bytecode_generator.funcs       = cfg.funcs;
+    bytecode_generator.global_vars = ir_generator.global_var_decl;
+    bytecode_generator.ir2VmInst();
+    if (options.peephole)
+    {
+        PeepholeOptimization peephole;
+        peephole.block_list = &bytecode_generator.bytecode_basicblocks;
+        peephole.doPeepholeOptimization();
+        if (!options.no_superinstruction)
+        {
+            SuperInstruction superinstruction;
+            superinstruction.block_list = &bytecode_generator.bytecode_basicblocks;
+            superinstruction.doSuperInstruction();
+        }
+    }
+    bytecode_generator.relocation();
+
+    // keep the function only, jumps relative to its FUNC and calls into the running program
+    const auto &vm_insts = bytecode_generator.vm_insts;
+    auto begin           = std::find_if(vm_insts.begin(), vm_insts.end(),
+                                        [](CVM::VMInstruction *inst) { return inst->opcode == CVM::Opcode::FUNC; });
+    const int base       = begin - vm_insts.begin();
+    // the global declarations in front of it are not linked
+    for (auto it = vm_insts.begin(); it != begin; it++) delete *it;
+    std::vector<CVM::VMInstruction *> insts(begin, vm_insts.end());
+    for (auto *inst : insts)
+    {
+        if (auto *jmp = dynamic_cast<CVM::Jmp *>(inst); jmp != nullptr)
+            jmp->target -= base;
+        else if (auto *jif = dynamic_cast<CVM::Jif *>(inst); jif != nullptr)
+        {
+            jif->target1 -= base;
+            jif->target2 -= base;
+        }
+        else if (auto *cmp_jmp = dynamic_cast<CVM::CmpJmp *>(inst); cmp_jmp != nullptr)
+            cmp_jmp->target -= base;
+        else if (auto *call = dynamic_cast<CVM::Call *>(inst); call != nullptr && call->target >= 0)
+        {
+            auto it = funcs_table.find(std::make_pair(call->name, call->argc));
+            if (it == funcs_table.end())
+            {
+                for (auto *dropped : insts) delete dropped;
+                return {};
+            }
+            call->target = it->second;
+        }
+    }
+    return insts;
+}
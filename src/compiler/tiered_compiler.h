@@ -0,0 +1,65 @@
+#ifndef CYX2_TIERED_COMPILER_H
+#define CYX2_TIERED_COMPILER_H
+
+#include "../common/config.h"
+#include "../core/program.h"
+#include "../core/tier.h"
+#include "bytecode/bytecode_generator.h"
+#include "bytecode/peephole_optimization.h"
+#include "bytecode/superinstruction.h"
+#include "ir/cfg.h"
+#include "ir/ir_generator.h"
+#include "parser.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace COMPILER
+{
+    // recompiles hot functions on a background thread with the optimizations given on the command line(SSA,
+    // constant folding, peephole ...), the VM starts from the program compiled without them.
+    //
+    // the source is lowered to IR once, a job takes the IR of one function through CFG, SSA and bytecode generation.
+    // call targets are resolved against the FUNC positions of the running program, which the VM redirects to the
+    // optimized versions it has linked.
+    class TieredCompiler : public CVM::Recompiler
+    {
+      public:
+        // `options` are the ones the hot functions get, the running program may be compiled with others
+        TieredCompiler(std::string code, const CVM::Program &program, const CompileOptions &options);
+        TieredCompiler(const TieredCompiler &)            = delete;
+        TieredCompiler &operator=(const TieredCompiler &) = delete;
+        ~TieredCompiler() override;
+        void request(int func, const std::string &name) override;
+        bool poll(CVM::Recompiled &result) override;
+
+      private:
+        void work();
+        // empty if the function can not be linked into the running program
+        std::vector<CVM::VMInstruction *> compile(const std::string &name);
+
+      private:
+        std::string code;
+        const CompileOptions options;
+        // (name, arity) -> FUNC position in the running program, the identity IRGenerator gives a function
+        std::map<std::pair<std::string, int>, int> funcs_table;
+        IRGenerator ir_generator{ options };
+        bool lowered{ false };
+        // shared with the VM thread
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::deque<std::pair<int, std::string>> jobs;
+        std::vector<CVM::Recompiled> results;
+        bool stop{ false };
+        std::thread worker;
+    };
+} // namespace COMPILER
+
+#endif // CYX2_TIERED_COMPILER_H
@@ -41,16 +41,32 @@ void CVM::BytecodeReader::readInsts()
             case CVM::Opcode::LOADX: readLoadX(); break;
             case CVM::Opcode::STOREX: readStoreX(); break;
             case CVM::Opcode::STOREA: readStoreA(); break;
-            case CVM::Opcode::CALL: readCall(); break;
+            case CVM::Opcode::CALL:
+            case CVM::Opcode::TAILCALL: readCall(); break;
             case CVM::Opcode::FUNC: readFunc(); break;
             case CVM::Opcode::ARG: readArg(); break;
-            case CVM::Opcode::PARAM: readParam(); break;
             case CVM::Opcode::RET: readRet(); break;
             case CVM::Opcode::JMP: readJmp(); break;
             case CVM::Opcode::JIF: readJif(); break;
-            default: LOGD("unknown opcode"); break;
+            case CVM::Opcode::MOVX: readMovX(); break;
+            default:
+            {
+                if (CVM::isArithmeticX(cur_opcode))
+                    readArithmeticX();
+                else if (CVM::isCmpJmp(cur_opcode))
+                    readCmpJmp();
+                else
+                    LOGD("unknown opcode");
+                break;
+            }
         }
     }
+    program.assemble(vm_insts);
+    program.entry             = entry;
+    program.entry_end         = entry_end;
+    program.global_var_len    = global_var_len;
+    program.global_slot_count = global_slot_count;
+    program.global_reg_count  = global_reg_count;
 }
 
 void CVM::BytecodeReader::readHeader()
@@ -60,7 +76,9 @@ void CVM::BytecodeReader::readHeader()
     entry             = readInt();
     entry_end         = readInt();
     global_var_len    = readInt();
-    if (magic_number != 0xc2 && version != 0x01) LOGE("bytecode file error!");
+    global_slot_count = readInt();
+    global_reg_count  = readInt();
+    if (magic_number != 0xc2 || version != 0x06) LOGE("bytecode file error!");
 }
 
 unsigned char CVM::BytecodeReader::readByte()
@@ -119,7 +137,7 @@ void CVM::BytecodeReader::readUnary()
     else if (type == 2)
     {
         inst->type = ArgType::MAP;
-        inst->name = readString();
+        inst->var  = readVarRef();
     }
     vm_insts.push_back(inst);
 }
@@ -159,7 +177,7 @@ void CVM::BytecodeReader::readLoadX()
 {
     auto *inst    = new LoadX;
     inst->reg_idx = readByte();
-    inst->name    = readString();
+    inst->var     = readVarRef();
     std::vector<CVM::ArrIdx> arr;
     readArrIdx(arr);
     inst->index = std::move(arr);
@@ -193,7 +211,7 @@ void CVM::BytecodeReader::readLoadXA()
     auto *inst    = new LoadXA;
     inst->reg_idx = readByte();
     inst->index   = readInt();
-    inst->name    = readString();
+    inst->var     = readVarRef();
     vm_insts.push_back(inst);
 }
 
@@ -228,7 +246,7 @@ void CVM::BytecodeReader::readLoad()
 void CVM::BytecodeReader::readStoreX()
 {
     auto *inst = new StoreX;
-    inst->name = readString();
+    inst->var  = readVarRef();
     std::vector<ArrIdx> arr;
     readArrIdx(arr);
     inst->reg_idx = readByte();
@@ -239,7 +257,7 @@ void CVM::BytecodeReader::readStoreX()
 void CVM::BytecodeReader::readStoreA()
 {
     auto *inst = new StoreA;
-    inst->name = readString();
+    inst->var  = readVarRef();
     std::vector<ArrIdx> arr;
     readArrIdx(arr);
     inst->index   = std::move(arr);
@@ -259,21 +277,21 @@ void CVM::BytecodeReader::readStore()
     if constexpr (std::is_same<T, long long>())
     {
         auto *inst = new StoreI;
-        inst->name = readString();
+        inst->var  = readVarRef();
         inst->val  = readInt();
         vm_insts.push_back(inst);
     }
     else if constexpr (std::is_same<T, double>())
     {
         auto *inst = new StoreD;
-        inst->name = readString();
+        inst->var  = readVarRef();
         inst->val  = readDouble();
         vm_insts.push_back(inst);
     }
     else if constexpr (std::is_same<T, std::string>())
     {
         auto *inst = new StoreS;
-        inst->name = readString();
+        inst->var  = readVarRef();
         inst->val  = readString();
         vm_insts.push_back(inst);
     }
@@ -303,7 +321,7 @@ void CVM::BytecodeReader::readArg()
     }
     else if (inst->type == CVM::ArgType::MAP)
     {
-        inst->name = readString();
+        inst->var = readVarRef();
         std::vector<ArrIdx> arr_idx;
         readArrIdx(arr_idx);
         inst->index = std::move(arr_idx);
@@ -314,7 +332,9 @@ void CVM::BytecodeReader::readArg()
 void CVM::BytecodeReader::readCall()
 {
     auto *inst   = new Call;
+    inst->opcode = cur_opcode;
     inst->target = readInt();
+    inst->argc   = readInt();
     vm_insts.push_back(inst);
 }
 
@@ -322,13 +342,8 @@ void CVM::BytecodeReader::readFunc()
 {
     auto *inst        = new Func;
     inst->param_count = readByte();
-    vm_insts.push_back(inst);
-}
-
-void CVM::BytecodeReader::readParam()
-{
-    auto *inst = new Param;
-    inst->name = readString();
+    inst->slot_count  = readInt();
+    inst->reg_count   = readInt();
     vm_insts.push_back(inst);
 }
 
@@ -353,6 +368,53 @@ void CVM::BytecodeReader::readJif()
     vm_insts.push_back(inst);
 }
 
+void CVM::BytecodeReader::readArithmeticX()
+{
+    auto *inst = new ArithmeticX(cur_opcode);
+    inst->dst  = readVarRef();
+    inst->src1 = readVarRef();
+    if (inst->isImm())
+        inst->imm = readImm();
+    else
+        inst->src2 = readVarRef();
+    vm_insts.push_back(inst);
+}
+
+void CVM::BytecodeReader::readCmpJmp()
+{
+    auto *inst = new CmpJmp(cur_opcode);
+    inst->src1 = readVarRef();
+    if (inst->isImm())
+        inst->imm = readImm();
+    else
+        inst->src2 = readVarRef();
+    inst->target = readInt();
+    vm_insts.push_back(inst);
+}
+
+void CVM::BytecodeReader::readMovX()
+{
+    auto *inst = new MovX;
+    inst->dst  = readVarRef();
+    inst->src  = readVarRef();
+    vm_insts.push_back(inst);
+}
+
+CYX::Value CVM::BytecodeReader::readImm()
+{
+    const auto type = readByte();
+    if (type == 0) return CYX::Value(readInt());
+    return CYX::Value(readDouble());
+}
+
+CVM::VarRef CVM::BytecodeReader::readVarRef()
+{
+    VarRef var(readString());
+    var.slot   = readInt();
+    var.global = readByte() == 1;
+    return var;
+}
+
 void CVM::BytecodeReader::readArrIdx(std::vector<ArrIdx> &arr_idx)
 {
     auto arr_size = readInt();
@@ -365,7 +427,7 @@ void CVM::BytecodeReader::readArrIdx(std::vector<ArrIdx> &arr_idx)
         }
         else if (type == 2)
         {
-            arr_idx.emplace_back(readString());
+            arr_idx.emplace_back(readVarRef());
         }
         else
             UNREACHABLE();
@@ -3,6 +3,7 @@
 
 #include "../utility/log.h"
 #include "opcode.hpp"
+#include "program.h"
 #include "vm_instruction.hpp"
 
 #include <cmath>
@@ -47,18 +48,26 @@ namespace CVM
         void readArg();
         void readCall();
         void readFunc();
-        void readParam();
         void readRet();
         void readJmp();
         void readJif();
         //
+        void readArithmeticX();
+        void readCmpJmp();
+        void readMovX();
+        //
+        CYX::Value readImm();
+        VarRef readVarRef();
         void readArrIdx(std::vector<ArrIdx> &arr_idx);
 
       public:
         int entry{ -1 };
         int entry_end{ -1 };
         int global_var_len{ -1 };
+        int global_slot_count{ 0 };
+        int global_reg_count{ 0 };
         std::vector<VMInstruction *> vm_insts;
+        Program program;
 
       private:
         Opcode cur_opcode;
@@ -1,16 +1,23 @@
 #ifndef CVM_FRAME_HPP
 #define CVM_FRAME_HPP
 
-#include "../common/value.hpp"
-
-#include <unordered_map>
-
 namespace CVM
 {
+    // a window of VM value stack, locals and params are indexed by VarRef::slot, registers follow the slots
     class Frame
     {
       public:
-        std::unordered_map<std::string, CYX::Value> symbols;
+        Frame() = default;
+        Frame(int base, int slot_count, int reg_count) : base(base), slot_count(slot_count), reg_count(reg_count)
+        {
+        }
+        int regBase() const
+        {
+            return base + slot_count;
+        }
+        int base{ 0 }; // first slot in the value stack
+        int slot_count{ 0 };
+        int reg_count{ 0 };
         int pc{ -1 };
     };
 } // namespace CVM
@@ -0,0 +1,861 @@
+#include "jit.h"
+
+#ifdef CYX_JIT
+    #include "../utility/utility.hpp"
+    #include "vm.hpp"
+
+    #include <cstring>
+    #include <initializer_list>
+    #include <sys/mman.h>
+    #include <unistd.h>
+
+using Tag = CYX::Value::Tag;
+
+static const int VALUE_SIZE = sizeof(CYX::Value);
+static const int TAG_OFFSET = 8; // payload is at 0, see layoutMatches
+
+namespace CVM
+{
+    enum Register
+    {
+        RAX,
+        RCX,
+        RDX,
+        RBX,
+        RSP,
+        RBP,
+        RSI,
+        RDI,
+        R8,
+        R9,
+        R10,
+        R11,
+        R12,
+        R13,
+        R14,
+        R15
+    };
+
+    // condition codes of jcc
+    enum Condition
+    {
+        CC_B  = 0x2,
+        CC_AE = 0x3,
+        CC_E  = 0x4,
+        CC_NE = 0x5,
+        CC_BE = 0x6,
+        CC_A  = 0x7,
+        CC_P  = 0xa,
+        CC_L  = 0xc,
+        CC_GE = 0xd,
+        CC_LE = 0xe,
+        CC_G  = 0xf
+    };
+
+    // encoder of the few x86-64 instruction forms the templates need, memory operands are [base + disp32]
+    class Assembler
+    {
+      public:
+        int newLabel()
+        {
+            labels.push_back(-1);
+            return static_cast<int>(labels.size()) - 1;
+        }
+        void bind(int label)
+        {
+            labels[label] = static_cast<int>(code.size());
+        }
+        int offset(int label) const
+        {
+            return labels[label];
+        }
+        void jmp(int label)
+        {
+            byte(0xe9);
+            fixup(label);
+        }
+        void jcc(Condition cc, int label)
+        {
+            byte(0x0f);
+            byte(0x80 | cc);
+            fixup(label);
+        }
+        // <prefix> <rex> <opcode> reg, [base + disp]
+        void mem(int prefix, bool w, std::initializer_list<int> opcode, int reg, int base, int disp)
+        {
+            if (prefix != 0) byte(prefix);
+            rex(w, reg, base);
+            for (auto x : opcode)
+            {
+                byte(x);
+            }
+            byte(0x80 | (reg & 7) << 3 | (base & 7));
+            if ((base & 7) == RSP) byte(0x24);
+            int32(disp);
+        }
+        // <prefix> <rex> <opcode> reg, rm
+        void rr(int prefix, bool w, std::initializer_list<int> opcode, int reg, int rm)
+        {
+            if (prefix != 0) byte(prefix);
+            rex(w, reg, rm);
+            for (auto x : opcode)
+            {
+                byte(x);
+            }
+            byte(0xc0 | (reg & 7) << 3 | (rm & 7));
+        }
+        void movImm(int reg, long long imm)
+        {
+            rex(true, 0, reg);
+            byte(0xb8 | (reg & 7));
+            int64(imm);
+        }
+        void push(int reg)
+        {
+            if (reg >= R8) byte(0x41);
+            byte(0x50 | (reg & 7));
+        }
+        void pop(int reg)
+        {
+            if (reg >= R8) byte(0x41);
+            byte(0x58 | (reg & 7));
+        }
+        void call(const void *func)
+        {
+            movImm(RAX, reinterpret_cast<long long>(func));
+            rr(0, false, { 0xff }, 2, RAX);
+        }
+        // patch the jumps, false if a label is never bound
+        bool finish()
+        {
+            for (const auto &[pos, label] : fixups)
+            {
+                if (labels[label] < 0) return false;
+                const int rel = labels[label] - (pos + 4);
+                std::memcpy(&code[pos], &rel, 4);
+            }
+            return true;
+        }
+        void byte(int x)
+        {
+            code.push_back(static_cast<unsigned char>(x));
+        }
+        void int32(int x)
+        {
+            const auto pos = code.size();
+            code.resize(pos + 4);
+            std::memcpy(&code[pos], &x, 4);
+        }
+        void int64(long long x)
+        {
+            const auto pos = code.size();
+            code.resize(pos + 8);
+            std::memcpy(&code[pos], &x, 8);
+        }
+
+      public:
+        std::vector<unsigned char> code;
+
+      private:
+        void rex(bool w, int reg, int base)
+        {
+            const int bits = (w ? 8 : 0) | (reg >= R8 ? 4 : 0) | (base >= R8 ? 1 : 0);
+            if (bits != 0) byte(0x40 | bits);
+        }
+        void fixup(int label)
+        {
+            fixups.emplace_back(static_cast<int>(code.size()), label);
+            int32(0);
+        }
+
+      private:
+        std::vector<int> labels;
+        std::vector<std::pair<int, int>> fixups; // rel32 position, label
+    };
+} // namespace CVM
+
+// the templates read Value as a raw 8 byte payload followed by the tag byte
+static bool layoutMatches()
+{
+    const CYX::Value probe(2.5);
+    const auto *bytes = reinterpret_cast<const unsigned char *>(&probe);
+    double payload    = 0;
+    std::memcpy(&payload, bytes, sizeof(payload));
+    return VALUE_SIZE == 16 && payload == 2.5 && bytes[TAG_OFFSET] == static_cast<unsigned char>(Tag::DOUBLE);
+}
+
+static void cmpTag(CVM::Assembler &as, CVM::JIT::Mem mem, Tag tag)
+{
+    as.mem(0, false, { 0x80 }, 7, mem.base, mem.disp + TAG_OFFSET);
+    as.byte(static_cast<int>(tag));
+}
+
+static void setTag(CVM::Assembler &as, CVM::JIT::Mem mem, Tag tag)
+{
+    as.mem(0, false, { 0xc6 }, 0, mem.base, mem.disp + TAG_OFFSET);
+    as.byte(static_cast<int>(tag));
+}
+
+// a heap value must be released by the VM before it is overwritten
+static void guardScalar(CVM::Assembler &as, CVM::JIT::Mem mem, int slow)
+{
+    cmpTag(as, mem, Tag::STRING);
+    as.jcc(CVM::CC_AE, slow);
+}
+
+static void loadPayload(CVM::Assembler &as, int reg, CVM::JIT::Mem mem)
+{
+    as.mem(0, true, { 0x8b }, reg, mem.base, mem.disp);
+}
+
+static void storePayload(CVM::Assembler &as, CVM::JIT::Mem mem, int reg)
+{
+    as.mem(0, true, { 0x89 }, reg, mem.base, mem.disp);
+}
+
+// int or double as double in `xmm`, anything else goes to `slow`
+static void loadDouble(CVM::Assembler &as, int xmm, CVM::JIT::Mem mem, int slow)
+{
+    const int is_double = as.newLabel();
+    const int done      = as.newLabel();
+    cmpTag(as, mem, Tag::DOUBLE);
+    as.jcc(CVM::CC_E, is_double);
+    cmpTag(as, mem, Tag::INT);
+    as.jcc(CVM::CC_NE, slow);
+    as.mem(0xf2, true, { 0x0f, 0x2a }, xmm, mem.base, mem.disp); // cvtsi2sd
+    as.jmp(done);
+    as.bind(is_double);
+    as.mem(0xf2, false, { 0x0f, 0x10 }, xmm, mem.base, mem.disp); // movsd
+    as.bind(done);
+}
+
+static void loadDoubleImm(CVM::Assembler &as, int xmm, const CYX::Value &imm)
+{
+    const double value = imm.type() == Tag::INT ? static_cast<double>(imm.value<long long>()) : imm.value<double>();
+    long long bits     = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    as.movImm(CVM::RCX, bits);
+    as.rr(0x66, true, { 0x0f, 0x6e }, xmm, CVM::RCX); // movq
+}
+
+static bool isNumber(const CYX::Value &value)
+{
+    return value.type() == Tag::INT || value.type() == Tag::DOUBLE;
+}
+
+CVM::JIT::~JIT()
+{
+    for (const auto &[buffer, size] : buffers)
+    {
+        munmap(buffer, size);
+    }
+}
+
+void CVM::JIT::load(const CVM::Program &program, bool enable)
+{
+    enabled = enable && layoutMatches();
+    funcs.resize(program.code.size());
+}
+
+bool CVM::JIT::enter(CVM::VM *vm, int target)
+{
+    if (!prepare(vm, target)) return false;
+    depth++;
+    funcs[target].native(vm, vm->stack.data(), &vm->stack[vm->frame.back().base], nullptr);
+    depth--;
+    return true;
+}
+
+bool CVM::JIT::enterLoop(CVM::VM *vm, int func, int target)
+{
+    if (!prepare(vm, func)) return false;
+    auto it = funcs[func].loops.find(target);
+    if (it == funcs[func].loops.end()) return false;
+    depth++;
+    funcs[func].native(vm, vm->stack.data(), &vm->stack[vm->frame.back().base], it->second);
+    depth--;
+    return true;
+}
+
+bool CVM::JIT::prepare(CVM::VM *vm, int func)
+{
+    if (!enabled || depth >= JIT_MAX_DEPTH) return false;
+    auto &target = funcs[func];
+    if (target.native == nullptr)
+    {
+        if (target.failed || vm->hotness[func] < JIT_THRESHOLD) return false;
+        target.native = compile(vm->program, func);
+        target.failed = target.native == nullptr;
+    }
+    return !target.failed;
+}
+
+CVM::JIT::NativeFunc CVM::JIT::compile(const CVM::Program &program, int func)
+{
+    const auto &code = program.code;
+    begin            = func + 1;
+    int end          = begin;
+    while (end < code.size() && code[end].opcode != Opcode::FUNC)
+    {
+        end++;
+    }
+    slot_count = code[func].b;
+    // the native code must not run off the end of the function
+    if (begin == end || !inOr(code[end - 1].opcode, Opcode::RET, Opcode::JMP, Opcode::TAILCALL)) return nullptr;
+
+    Assembler as;
+    for (int pc = begin; pc < end; pc++)
+    {
+        as.newLabel();
+    }
+    // five pushes keep rsp 16 byte aligned at every call
+    for (auto x : { RBX, R12, R13, R14, R15 })
+    {
+        as.push(x);
+    }
+    as.rr(0, true, { 0x8b }, RBX, RDI);
+    as.rr(0, true, { 0x8b }, RAX, RSI);
+    emitReload(as);
+    // jmp resume, if any
+    const int start = as.newLabel();
+    as.rr(0, true, { 0x85 }, RCX, RCX);
+    as.jcc(CC_E, start);
+    as.rr(0, false, { 0xff }, 4, RCX);
+    as.bind(start);
+    std::vector<int> headers;
+    for (int pc = begin; pc < end; pc++)
+    {
+        as.bind(label(pc));
+        if (!emit(as, program, pc, end)) return nullptr;
+        if (code[pc].opcode == Opcode::JMP && code[pc].b < pc) headers.push_back(code[pc].b);
+    }
+    if (!as.finish()) return nullptr;
+
+    const size_t page = sysconf(_SC_PAGESIZE);
+    const size_t size = (as.code.size() + page - 1) / page * page;
+    void *buffer      = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffer == MAP_FAILED) return nullptr;
+    std::memcpy(buffer, as.code.data(), as.code.size());
+    if (mprotect(buffer, size, PROT_READ | PROT_EXEC) != 0)
+    {
+        munmap(buffer, size);
+        return nullptr;
+    }
+    buffers.emplace_back(buffer, size);
+    for (auto header : headers)
+    {
+        funcs[func].loops[header] = static_cast<unsigned char *>(buffer) + as.offset(label(header));
+    }
+    return reinterpret_cast<NativeFunc>(buffer);
+}
+
+bool CVM::JIT::emit(CVM::Assembler &as, const CVM::Program &program, int pc, int end)
+{
+    const auto &inst = program.code[pc];
+    auto inRange     = [&](int target) { return target >= begin && target < end; };
+    auto shift       = [](Opcode op, Opcode from, Opcode to)
+    { return uchar2Opcode(opcode2UChar(to) + opcode2UChar(op) - opcode2UChar(from)); };
+    const auto op = genericOpcode(inst.opcode);
+    switch (op)
+    {
+        case Opcode::ADD:
+        case Opcode::SUB:
+        case Opcode::MUL:
+        case Opcode::DIV:
+        case Opcode::MOD:
+        {
+            const auto rhs = reg(inst.b);
+            emitArithmetic(as, op, reg(inst.a), reg(inst.a), &rhs, nullptr, pc);
+            break;
+        }
+        case Opcode::NE:
+        case Opcode::EQ:
+        case Opcode::LT:
+        case Opcode::LE:
+        case Opcode::GT:
+        case Opcode::GE: emitCompare(as, op, reg(inst.a), reg(inst.b), pc); break;
+        case Opcode::LOADI:
+        case Opcode::LOADD: emitConstant(as, reg(inst.a), program.constants[inst.b], pc); break;
+        case Opcode::STOREI:
+        case Opcode::STORED: emitConstant(as, var(inst.b), program.constants[inst.c], pc); break;
+        case Opcode::LOADX:
+        {
+            const auto &chain = program.chains[inst.b];
+            if (chain.begin == chain.end)
+                emitMove(as, reg(inst.a), var(chain.var), pc);
+            else
+                emitStep(as, pc);
+            break;
+        }
+        case Opcode::STOREX:
+        {
+            const auto &chain = program.chains[inst.b];
+            if (chain.begin == chain.end)
+                emitMove(as, var(chain.var), reg(inst.a), pc);
+            else
+                emitStep(as, pc);
+            break;
+        }
+        case Opcode::MOVX: emitMove(as, var(inst.b), var(inst.c), pc); break;
+        case Opcode::ADDXX:
+        case Opcode::SUBXX:
+        case Opcode::MULXX:
+        case Opcode::DIVXX:
+        case Opcode::MODXX:
+        {
+            const auto rhs = var(inst.d);
+            emitArithmetic(as, shift(op, Opcode::ADDXX, Opcode::ADD), var(inst.b), var(inst.c), &rhs, nullptr, pc);
+            break;
+        }
+        case Opcode::ADDXI:
+        case Opcode::SUBXI:
+        case Opcode::MULXI:
+        case Opcode::DIVXI:
+        case Opcode::MODXI:
+            emitArithmetic(as, shift(op, Opcode::ADDXI, Opcode::ADD), var(inst.b), var(inst.c), nullptr,
+                           &program.constants[inst.d], pc);
+            break;
+        case Opcode::JNEXX:
+        case Opcode::JEQXX:
+        case Opcode::JLTXX:
+        case Opcode::JLEXX:
+        case Opcode::JGTXX:
+        case Opcode::JGEXX:
+        {
+            if (!inRange(inst.d)) return false;
+            const auto rhs = var(inst.c);
+            emitCmpJmp(as, shift(op, Opcode::JNEXX, Opcode::NE), var(inst.b), &rhs, nullptr, label(inst.d), pc);
+            break;
+        }
+        case Opcode::JNEXI:
+        case Opcode::JEQXI:
+        case Opcode::JLTXI:
+        case Opcode::JLEXI:
+        case Opcode::JGTXI:
+        case Opcode::JGEXI:
+            if (!inRange(inst.d)) return false;
+            emitCmpJmp(as, shift(op, Opcode::JNEXI, Opcode::NE), var(inst.b), nullptr, &program.constants[inst.c],
+                       label(inst.d), pc);
+            break;
+        case Opcode::JMP:
+            if (!inRange(inst.b)) return false;
+            as.jmp(label(inst.b));
+            break;
+        case Opcode::JIF:
+        {
+            if (!inRange(inst.b) || !inRange(inst.c)) return false;
+            // an int state is tested and cleared inline
+            const auto state = reg(STATE_REGISTER);
+            const int slow   = as.newLabel();
+            cmpTag(as, state, Tag::INT);
+            as.jcc(CC_NE, slow);
+            loadPayload(as, RAX, state);
+            as.mem(0, true, { 0xc7 }, 0, state.base, state.disp);
+            as.int32(0);
+            as.rr(0, true, { 0x85 }, RAX, RAX);
+            as.jcc(CC_NE, label(inst.b));
+            as.jmp(label(inst.c));
+            as.bind(slow);
+            as.rr(0, true, { 0x8b }, RDI, RBX);
+            as.call(reinterpret_cast<const void *>(&JIT::test));
+            as.rr(0, false, { 0x84 }, RAX, RAX);
+            as.jcc(CC_NE, label(inst.b));
+            as.jmp(label(inst.c));
+            break;
+        }
+        case Opcode::CALL:
+        case Opcode::ARG:
+            as.rr(0, true, { 0x8b }, RDI, RBX);
+            as.byte(0xbe); // mov esi, pc
+            as.int32(pc);
+            as.call(op == Opcode::CALL ? reinterpret_cast<const void *>(&JIT::call)
+                                       : reinterpret_cast<const void *>(&JIT::arg));
+            emitReload(as);
+            break;
+        case Opcode::TAILCALL:
+        {
+            // a tail call to itself loops, any other callee has returned for this function
+            const int done = as.newLabel();
+            as.rr(0, true, { 0x8b }, RDI, RBX);
+            as.byte(0xbe); // mov esi, pc
+            as.int32(pc);
+            as.byte(0xba); // mov edx, func
+            as.int32(begin - 1);
+            as.call(reinterpret_cast<const void *>(&JIT::tailCall));
+            as.rr(0, true, { 0x85 }, RAX, RAX);
+            as.jcc(CC_E, done);
+            emitReload(as);
+            as.jmp(label(begin));
+            as.bind(done);
+            emitEpilogue(as);
+            break;
+        }
+        case Opcode::RET:
+            as.rr(0, true, { 0x8b }, RDI, RBX);
+            as.call(reinterpret_cast<const void *>(&JIT::ret));
+            emitEpilogue(as);
+            break;
+        case Opcode::EXP:
+        case Opcode::BAND:
+        case Opcode::BOR:
+        case Opcode::BXOR:
+        case Opcode::SHL:
+        case Opcode::SHR:
+        case Opcode::LOR:
+        case Opcode::LAND:
+        case Opcode::LNOT:
+        case Opcode::BNOT:
+        case Opcode::LOADS:
+        case Opcode::LOADA:
+        case Opcode::LOADXA:
+        case Opcode::STORES:
+        case Opcode::STOREA: emitStep(as, pc); break;
+        default: return false;
+    }
+    return true;
+}
+
+void CVM::JIT::emitCondition(CVM::Assembler &as, CVM::Opcode cmp, CVM::JIT::Mem lhs, const CVM::JIT::Mem *rhs,
+                             const CYX::Value *imm, int fail, int slow)
+{
+    if (imm != nullptr && !isNumber(*imm))
+    {
+        as.jmp(slow);
+        return;
+    }
+    const int not_int = as.newLabel();
+    const int done    = as.newLabel();
+    if (imm == nullptr || imm->type() == Tag::INT)
+    {
+        cmpTag(as, lhs, Tag::INT);
+        as.jcc(CC_NE, not_int);
+        if (rhs != nullptr)
+        {
+            cmpTag(as, *rhs, Tag::INT);
+            as.jcc(CC_NE, not_int);
+            loadPayload(as, RCX, *rhs);
+        }
+        else
+            as.movImm(RCX, imm->value<long long>());
+        loadPayload(as, RAX, lhs);
+        as.rr(0, true, { 0x3b }, RAX, RCX);
+        // jump if the comparison fails
+        const Condition inverse[] = { CC_E, CC_NE, CC_GE, CC_G, CC_LE, CC_L };
+        as.jcc(inverse[opcode2UChar(cmp) - opcode2UChar(Opcode::NE)], fail);
+        as.jmp(done);
+    }
+    // ints or doubles with at least one double, compared as doubles, unordered fails everything but !=
+    as.bind(not_int);
+    loadDouble(as, 0, lhs, slow);
+    if (rhs != nullptr)
+        loadDouble(as, 1, *rhs, slow);
+    else
+        loadDoubleImm(as, 1, *imm);
+    auto ucomisd = [&](int x, int y) { as.rr(0x66, false, { 0x0f, 0x2e }, x, y); };
+    switch (cmp)
+    {
+        case Opcode::NE:
+            ucomisd(0, 1);
+            as.jcc(CC_P, done);
+            as.jcc(CC_E, fail);
+            break;
+        case Opcode::EQ:
+            ucomisd(0, 1);
+            as.jcc(CC_P, fail);
+            as.jcc(CC_NE, fail);
+            break;
+        case Opcode::LT:
+            ucomisd(1, 0);
+            as.jcc(CC_BE, fail);
+            break;
+        case Opcode::LE:
+            ucomisd(1, 0);
+            as.jcc(CC_B, fail);
+            break;
+        case Opcode::GT:
+            ucomisd(0, 1);
+            as.jcc(CC_BE, fail);
+            break;
+        case Opcode::GE:
+            ucomisd(0, 1);
+            as.jcc(CC_B, fail);
+            break;
+        default: UNREACHABLE();
+    }
+    as.bind(done);
+}
+
+void CVM::JIT::emitArithmetic(CVM::Assembler &as, CVM::Opcode op, CVM::JIT::Mem dst, CVM::JIT::Mem lhs,
+                              const CVM::JIT::Mem *rhs, const CYX::Value *imm, int pc)
+{
+    const bool int_path    = imm == nullptr || imm->type() == Tag::INT;
+    const bool double_path = op != Opcode::MOD && (imm == nullptr || isNumber(*imm));
+    if (!int_path && !double_path)
+    {
+        emitStep(as, pc);
+        return;
+    }
+    const int slow    = as.newLabel();
+    const int next    = as.newLabel();
+    const int not_int = as.newLabel();
+    guardScalar(as, dst, slow);
+    if (int_path)
+    {
+        cmpTag(as, lhs, Tag::INT);
+        as.jcc(CC_NE, not_int);
+        if (rhs != nullptr)
+        {
+            cmpTag(as, *rhs, Tag::INT);
+            as.jcc(CC_NE, not_int);
+            loadPayload(as, RCX, *rhs);
+        }
+        else
+            as.movImm(RCX, imm->value<long long>());
+        loadPayload(as, RAX, lhs);
+        switch (op)
+        {
+            case Opcode::ADD: as.rr(0, true, { 0x03 }, RAX, RCX); break;
+            case Opcode::SUB: as.rr(0, true, { 0x2b }, RAX, RCX); break;
+            case Opcode::MUL: as.rr(0, true, { 0x0f, 0xaf }, RAX, RCX); break;
+            case Opcode::DIV:
+            case Opcode::MOD:
+                // cqo; idiv rcx, a zero divisor traps like the interpreter
+                as.byte(0x48);
+                as.byte(0x99);
+                as.rr(0, true, { 0xf7 }, 7, RCX);
+                if (op == Opcode::MOD) as.rr(0, true, { 0x8b }, RAX, RDX);
+                break;
+            default: UNREACHABLE();
+        }
+        storePayload(as, dst, RAX);
+        setTag(as, dst, Tag::INT);
+        as.jmp(next);
+    }
+    as.bind(not_int);
+    if (double_path)
+    {
+        loadDouble(as, 0, lhs, slow);
+        if (rhs != nullptr)
+            loadDouble(as, 1, *rhs, slow);
+        else
+            loadDoubleImm(as, 1, *imm);
+        const int sse_op = op == Opcode::ADD ? 0x58 : op == Opcode::SUB ? 0x5c : op == Opcode::MUL ? 0x59 : 0x5e;
+        as.rr(0xf2, false, { 0x0f, sse_op }, 0, 1);
+        as.mem(0xf2, false, { 0x0f, 0x11 }, 0, dst.base, dst.disp); // movsd
+        setTag(as, dst, Tag::DOUBLE);
+        as.jmp(next);
+    }
+    else
+        as.jmp(slow);
+    as.bind(slow);
+    emitStep(as, pc);
+    as.bind(next);
+}
+
+void CVM::JIT::emitCompare(CVM::Assembler &as, CVM::Opcode cmp, CVM::JIT::Mem lhs, CVM::JIT::Mem rhs, int pc)
+{
+    const auto state = reg(STATE_REGISTER);
+    const int slow   = as.newLabel();
+    const int next   = as.newLabel();
+    const int fail   = as.newLabel();
+    const int result = as.newLabel();
+    guardScalar(as, state, slow);
+    emitCondition(as, cmp, lhs, &rhs, nullptr, fail, slow);
+    as.byte(0xb8); // mov eax, 1
+    as.int32(1);
+    as.jmp(result);
+    as.bind(fail);
+    as.rr(0, false, { 0x33 }, RAX, RAX);
+    as.bind(result);
+    storePayload(as, state, RAX);
+    setTag(as, state, Tag::INT);
+    as.jmp(next);
+    as.bind(slow);
+    emitStep(as, pc);
+    as.bind(next);
+}
+
+void CVM::JIT::emitCmpJmp(CVM::Assembler &as, CVM::Opcode cmp, CVM::JIT::Mem lhs, const CVM::JIT::Mem *rhs,
+                          const CYX::Value *imm, int fail, int pc)
+{
+    const int slow = as.newLabel();
+    const int next = as.newLabel();
+    emitCondition(as, cmp, lhs, rhs, imm, fail, slow);
+    as.jmp(next);
+    as.bind(slow);
+    as.rr(0, true, { 0x8b }, RDI, RBX);
+    as.byte(0xbe); // mov esi, pc
+    as.int32(pc);
+    as.call(reinterpret_cast<const void *>(&JIT::compare));
+    as.rr(0, false, { 0x84 }, RAX, RAX);
+    as.jcc(CC_E, fail);
+    as.bind(next);
+}
+
+void CVM::JIT::emitMove(CVM::Assembler &as, CVM::JIT::Mem dst, CVM::JIT::Mem src, int pc)
+{
+    const int slow = as.newLabel();
+    const int next = as.newLabel();
+    guardScalar(as, dst, slow);
+    guardScalar(as, src, slow);
+    loadPayload(as, RAX, src);
+    as.mem(0, false, { 0x0f, 0xb6 }, RCX, src.base, src.disp + TAG_OFFSET); // movzx ecx, tag
+    storePayload(as, dst, RAX);
+    as.mem(0, false, { 0x88 }, RCX, dst.base, dst.disp + TAG_OFFSET);
+    as.jmp(next);
+    as.bind(slow);
+    emitStep(as, pc);
+    as.bind(next);
+}
+
+void CVM::JIT::emitConstant(CVM::Assembler &as, CVM::JIT::Mem dst, const CYX::Value &value, int pc)
+{
+    if (!isNumber(value))
+    {
+        emitStep(as, pc);
+        return;
+    }
+    const int slow = as.newLabel();
+    const int next = as.newLabel();
+    long long bits = value.value<long long>();
+    if (value.type() == Tag::DOUBLE)
+    {
+        const double x = value.value<double>();
+        std::memcpy(&bits, &x, sizeof(bits));
+    }
+    guardScalar(as, dst, slow);
+    as.movImm(RAX, bits);
+    storePayload(as, dst, RAX);
+    setTag(as, dst, value.type());
+    as.jmp(next);
+    as.bind(slow);
+    emitStep(as, pc);
+    as.bind(next);
+}
+
+void CVM::JIT::emitStep(CVM::Assembler &as, int pc)
+{
+    as.rr(0, true, { 0x8b }, RDI, RBX);
+    as.byte(0xbe); // mov esi, pc
+    as.int32(pc);
+    as.call(reinterpret_cast<const void *>(&JIT::step));
+}
+
+void CVM::JIT::emitEpilogue(CVM::Assembler &as)
+{
+    for (auto x : { R15, R14, R13, R12, RBX })
+    {
+        as.pop(x);
+    }
+    as.byte(0xc3);
+}
+
+// Pointers in rax:rdx
+void CVM::JIT::emitReload(CVM::Assembler &as)
+{
+    as.rr(0, true, { 0x8b }, R14, RAX);
+    as.rr(0, true, { 0x8b }, R12, RDX);
+    as.mem(0, true, { 0x8d }, R13, RDX, slot_count * VALUE_SIZE); // lea
+}
+
+CVM::JIT::Mem CVM::JIT::var(int operand) const
+{
+    return operand >= 0 ? Mem{ R12, operand * VALUE_SIZE } : Mem{ R14, ~operand * VALUE_SIZE };
+}
+
+CVM::JIT::Mem CVM::JIT::reg(int idx) const
+{
+    return Mem{ R13, idx * VALUE_SIZE };
+}
+
+int CVM::JIT::label(int pc) const
+{
+    return pc - begin;
+}
+
+void CVM::JIT::step(CVM::VM *vm, int pc)
+{
+    vm->execute(pc, pc + 1);
+}
+
+CVM::JIT::Pointers CVM::JIT::arg(CVM::VM *vm, int pc)
+{
+    vm->cur_inst = &vm->program.code[pc];
+    vm->arg();
+    return pointers(vm);
+}
+
+CVM::JIT::Pointers CVM::JIT::call(CVM::VM *vm, int pc)
+{
+    vm->cur_inst = &vm->program.code[pc];
+    if (vm->cur_inst->b < 0)
+        vm->callBuildin();
+    else
+    {
+        // like VM::call, but the callee runs till its RET before the native caller goes on.
+        // the code may grow meanwhile, so nothing points into it
+        if (vm->recompiler != nullptr && vm->recompiler->ready()) vm->tierUp();
+        const auto target = vm->program.code[pc].b;
+        vm->heat(target);
+        vm->frame.back().pc = pc;
+        vm->pushFrame(vm->program.code[target].b, vm->program.code[target].d, vm->program.code[pc].c);
+        if (!vm->jit.enter(vm, target)) vm->execute(target + 1, -1);
+    }
+    return pointers(vm);
+}
+
+// like VM::tailCall, Pointers of the new frame if the callee is `func` itself, null once any other callee returned
+CVM::JIT::Pointers CVM::JIT::tailCall(CVM::VM *vm, int pc, int func)
+{
+    if (vm->recompiler != nullptr && vm->recompiler->ready()) vm->tierUp();
+    const auto target = vm->program.code[pc].b;
+    vm->heat(target);
+    vm->replaceFrame(target, vm->program.code[pc].c);
+    if (target == func) return pointers(vm);
+    if (!vm->jit.enter(vm, target)) vm->execute(target + 1, -1);
+    return Pointers{ nullptr, nullptr };
+}
+
+void CVM::JIT::ret(CVM::VM *vm)
+{
+    vm->ret();
+}
+
+bool CVM::JIT::compare(CVM::VM *vm, int pc)
+{
+    const auto &inst = vm->program.code[pc];
+    auto &cur_frame  = vm->frame.back();
+    const auto op    = genericOpcode(inst.opcode);
+    const auto &lhs  = vm->symbol(cur_frame, inst.b);
+    const auto &rhs  = op >= Opcode::JNEXI ? vm->program.constants[inst.c] : vm->symbol(cur_frame, inst.c);
+    switch (op)
+    {
+        case Opcode::JNEXX:
+        case Opcode::JNEXI: return lhs != rhs;
+        case Opcode::JEQXX:
+        case Opcode::JEQXI: return lhs == rhs;
+        case Opcode::JLTXX:
+        case Opcode::JLTXI: return lhs < rhs;
+        case Opcode::JLEXX:
+        case Opcode::JLEXI: return lhs <= rhs;
+        case Opcode::JGTXX:
+        case Opcode::JGTXI: return lhs > rhs;
+        case Opcode::JGEXX:
+        case Opcode::JGEXI: return lhs >= rhs;
+        default: UNREACHABLE();
+    }
+}
+
+bool CVM::JIT::test(CVM::VM *vm)
+{
+    auto &state       = vm->reg[STATE_REGISTER];
+    const bool result = static_cast<bool>(state);
+    state             = false;
+    return result;
+}
+
+CVM::JIT::Pointers CVM::JIT::pointers(CVM::VM *vm)
+{
+    return Pointers{ vm->stack.data(), &vm->stack[vm->frame.back().base] };
+}
+#endif
@@ -0,0 +1,116 @@
+#ifndef CVM_JIT_H
+#define CVM_JIT_H
+
+#include "../common/config.h"
+#include "../common/value.hpp"
+#include "program.h"
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// the templates are x86-64 machine code called with the System V convention, and the code buffer comes from mmap
+#if defined(__x86_64__) && defined(__linux__)
+    #define CYX_JIT
+#endif
+
+#ifdef CYX_JIT
+namespace CVM
+{
+    class VM;
+    class Assembler;
+
+    // baseline template JIT, a function is compiled once its VM::hotness reaches JIT_THRESHOLD and runs natively
+    // from its next call.
+    //
+    // every instruction becomes a fixed template: int and double fast paths are inlined, anything else calls back
+    // into the VM for that one instruction, so the semantics stay exactly the interpreter's.
+    // a function the JIT can not translate stays interpreted.
+    //
+    // the native code keeps every value in the frame of the VM, so an interpreted frame can move into it at any loop
+    // header as it is(on-stack replacement), `resume` is the native address of that header.
+    //
+    // native registers: rbx VM, r12 slots of the frame, r13 registers of the frame, r14 value stack(global frame)
+    class JIT
+    {
+      public:
+        // stack and slots of the current frame, returned in rax:rdx by the helpers which may grow the value stack
+        struct Pointers
+        {
+            CYX::Value *stack;
+            CYX::Value *slots;
+        };
+        using NativeFunc = void (*)(VM *vm, CYX::Value *stack, CYX::Value *slots, const void *resume);
+        // [base + disp] of a Value
+        struct Mem
+        {
+            int base;
+            int disp;
+        };
+
+      public:
+        JIT() = default;
+        JIT(const JIT &) = delete;
+        JIT &operator=(const JIT &) = delete;
+        ~JIT();
+        // the tables grow with the code, appended code keeps what is compiled
+        void load(const Program &program, bool enable);
+        // run the callee at `target`(FUNC) natively if it is compiled or just got hot, its frame is pushed already
+        bool enter(VM *vm, int target);
+        // continue the interpreted frame of `func` natively from the loop header `target`, it returns like `enter`
+        bool enterLoop(VM *vm, int func, int target);
+        bool compilable(int func) const
+        {
+            return enabled && !funcs[func].failed;
+        }
+
+      private:
+        struct Function
+        {
+            NativeFunc native{ nullptr };
+            bool failed{ false };
+            std::unordered_map<int, const void *> loops; // loop header -> its native code
+        };
+
+      private:
+        // compile `func` once it is hot, false if it stays interpreted
+        bool prepare(VM *vm, int func);
+        NativeFunc compile(const Program &program, int func);
+        bool emit(Assembler &as, const Program &program, int pc, int end);
+        // jump to `fail` if `lhs cmp rhs` does not hold, to `slow` if the operands are neither int nor double
+        void emitCondition(Assembler &as, Opcode cmp, Mem lhs, const Mem *rhs, const CYX::Value *imm, int fail,
+                           int slow);
+        void emitArithmetic(Assembler &as, Opcode op, Mem dst, Mem lhs, const Mem *rhs, const CYX::Value *imm,
+                            int pc);
+        void emitCompare(Assembler &as, Opcode cmp, Mem lhs, Mem rhs, int pc);
+        void emitCmpJmp(Assembler &as, Opcode cmp, Mem lhs, const Mem *rhs, const CYX::Value *imm, int fail, int pc);
+        void emitMove(Assembler &as, Mem dst, Mem src, int pc);
+        void emitConstant(Assembler &as, Mem dst, const CYX::Value &value, int pc);
+        void emitStep(Assembler &as, int pc);
+        void emitReload(Assembler &as);
+        void emitEpilogue(Assembler &as);
+        Mem var(int operand) const;
+        Mem reg(int idx) const;
+        int label(int pc) const;
+        // called by the native code
+        static void step(VM *vm, int pc);
+        static Pointers arg(VM *vm, int pc);
+        static Pointers call(VM *vm, int pc);
+        static Pointers tailCall(VM *vm, int pc, int func);
+        static void ret(VM *vm);
+        static bool compare(VM *vm, int pc);
+        static bool test(VM *vm);
+        static Pointers pointers(VM *vm);
+
+      private:
+        bool enabled{ false };
+        int depth{ 0 };         // nested native calls, limited by JIT_MAX_DEPTH
+        int begin{ 0 };         // first instruction of the function being compiled
+        int slot_count{ 0 };    // slots of the function being compiled
+        std::vector<Function> funcs;
+        std::vector<std::pair<void *, size_t>> buffers;
+    };
+} // namespace CVM
+#endif
+
+#endif // CVM_JIT_H
@@ -45,10 +45,102 @@ namespace CVM
         CALL,
         FUNC,
         ARG,
-        PARAM,
         RET,
         JMP, // unconditional jump
         JIF, // conditional jump, depend on `state`
+        // superinstructions, X: variable I: immediate
+        ADDXX,
+        SUBXX,
+        MULXX,
+        DIVXX,
+        MODXX,
+        ADDXI,
+        SUBXI,
+        MULXI,
+        DIVXI,
+        MODXI,
+        // compare and branch, fall through if the comparison holds
+        JNEXX,
+        JEQXX,
+        JLTXX,
+        JLEXX,
+        JGTXX,
+        JGEXX,
+        JNEXI,
+        JEQXI,
+        JLTXI,
+        JLEXI,
+        JGTXI,
+        JGEXI,
+        MOVX,
+        TAILCALL, // CALL whose callee takes over the frame of the caller
+        // quickened from the generic opcode by the VM after observing the operand types, never in bytecode
+        // _INT: int and int, _DOUBLE: int or double with at least one double, _STRING: string and string
+        ADD_INT,
+        SUB_INT,
+        MUL_INT,
+        DIV_INT,
+        MOD_INT,
+        NE_INT,
+        EQ_INT,
+        LT_INT,
+        LE_INT,
+        GT_INT,
+        GE_INT,
+        ADDXX_INT,
+        SUBXX_INT,
+        MULXX_INT,
+        DIVXX_INT,
+        MODXX_INT,
+        ADDXI_INT,
+        SUBXI_INT,
+        MULXI_INT,
+        DIVXI_INT,
+        MODXI_INT,
+        JNEXX_INT,
+        JEQXX_INT,
+        JLTXX_INT,
+        JLEXX_INT,
+        JGTXX_INT,
+        JGEXX_INT,
+        JNEXI_INT,
+        JEQXI_INT,
+        JLTXI_INT,
+        JLEXI_INT,
+        JGTXI_INT,
+        JGEXI_INT,
+        ADD_DOUBLE,
+        SUB_DOUBLE,
+        MUL_DOUBLE,
+        DIV_DOUBLE,
+        NE_DOUBLE,
+        EQ_DOUBLE,
+        LT_DOUBLE,
+        LE_DOUBLE,
+        GT_DOUBLE,
+        GE_DOUBLE,
+        ADDXX_DOUBLE,
+        SUBXX_DOUBLE,
+        MULXX_DOUBLE,
+        DIVXX_DOUBLE,
+        ADDXI_DOUBLE,
+        SUBXI_DOUBLE,
+        MULXI_DOUBLE,
+        DIVXI_DOUBLE,
+        JNEXX_DOUBLE,
+        JEQXX_DOUBLE,
+        JLTXX_DOUBLE,
+        JLEXX_DOUBLE,
+        JGTXX_DOUBLE,
+        JGEXX_DOUBLE,
+        JNEXI_DOUBLE,
+        JEQXI_DOUBLE,
+        JLTXI_DOUBLE,
+        JLEXI_DOUBLE,
+        JGTXI_DOUBLE,
+        JGEXI_DOUBLE,
+        ADD_STRING,
+        ADDXX_STRING,
         //
 
         UNKNOWN = 0xff,
@@ -64,6 +156,40 @@ namespace CVM
         return static_cast<Opcode>(x);
     }
 
+    static bool inline constexpr isArithmeticX(Opcode opcode)
+    {
+        return opcode >= Opcode::ADDXX && opcode <= Opcode::MODXI;
+    }
+
+    static bool inline constexpr isCmpJmp(Opcode opcode)
+    {
+        return opcode >= Opcode::JNEXX && opcode <= Opcode::JGEXI;
+    }
+
+    // the generic opcode a quickened one was specialized from, any other opcode is returned as is
+    static Opcode inline constexpr genericOpcode(Opcode opcode)
+    {
+        // [first, last] of quickened opcodes in the same order as the generic ones from `generic`
+        constexpr Opcode ranges[][3] = {
+            { Opcode::ADD_INT, Opcode::MOD_INT, Opcode::ADD },
+            { Opcode::NE_INT, Opcode::GE_INT, Opcode::NE },
+            { Opcode::ADDXX_INT, Opcode::JGEXI_INT, Opcode::ADDXX },
+            { Opcode::ADD_DOUBLE, Opcode::DIV_DOUBLE, Opcode::ADD },
+            { Opcode::NE_DOUBLE, Opcode::GE_DOUBLE, Opcode::NE },
+            { Opcode::ADDXX_DOUBLE, Opcode::DIVXX_DOUBLE, Opcode::ADDXX },
+            { Opcode::ADDXI_DOUBLE, Opcode::DIVXI_DOUBLE, Opcode::ADDXI },
+            { Opcode::JNEXX_DOUBLE, Opcode::JGEXI_DOUBLE, Opcode::JNEXX },
+            { Opcode::ADD_STRING, Opcode::ADD_STRING, Opcode::ADD },
+            { Opcode::ADDXX_STRING, Opcode::ADDXX_STRING, Opcode::ADDXX },
+        };
+        for (const auto &range : ranges)
+        {
+            if (opcode >= range[0] && opcode <= range[1])
+                return uchar2Opcode(opcode2UChar(range[2]) + opcode2UChar(opcode) - opcode2UChar(range[0]));
+        }
+        return opcode;
+    }
+
 } // namespace CVM
 
 #endif
@@ -0,0 +1,243 @@
+#include "program.h"
+
+void CVM::Program::assemble(const std::vector<VMInstruction *> &insts)
+{
+    code.clear();
+    code.reserve(insts.size());
+    for (auto *vm_inst : insts)
+    {
+        code.push_back(translate(vm_inst));
+    }
+}
+
+int CVM::Program::append(const std::vector<VMInstruction *> &insts)
+{
+    const int base = code.size();
+    for (auto *vm_inst : insts)
+    {
+        auto inst = translate(vm_inst);
+        if (inst.opcode == Opcode::JMP)
+            inst.b += base;
+        else if (inst.opcode == Opcode::JIF)
+        {
+            inst.b += base;
+            inst.c += base;
+        }
+        else if (isCmpJmp(inst.opcode))
+            inst.d += base;
+        code.push_back(inst);
+    }
+    return base;
+}
+
+CVM::Instruction CVM::Program::translate(VMInstruction *vm_inst)
+{
+    Instruction inst;
+    inst.opcode = vm_inst->opcode;
+    switch (vm_inst->opcode)
+    {
+        case Opcode::ADD:
+        case Opcode::SUB:
+        case Opcode::MUL:
+        case Opcode::DIV:
+        case Opcode::MOD:
+        case Opcode::EXP:
+        case Opcode::BAND:
+        case Opcode::BOR:
+        case Opcode::BXOR:
+        case Opcode::SHL:
+        case Opcode::SHR:
+        case Opcode::LOR:
+        case Opcode::NE:
+        case Opcode::EQ:
+        case Opcode::LT:
+        case Opcode::LE:
+        case Opcode::GT:
+        case Opcode::GE:
+        case Opcode::LAND:
+        {
+            auto *tmp = static_cast<Binary *>(vm_inst);
+            inst.a    = tmp->reg_idx1;
+            inst.b    = tmp->reg_idx2;
+            break;
+        }
+        case Opcode::LNOT:
+        case Opcode::BNOT: inst.a = static_cast<Unary *>(vm_inst)->reg_idx; break;
+        case Opcode::LOADI:
+        {
+            auto *tmp = static_cast<LoadI *>(vm_inst);
+            inst.a    = tmp->reg_idx;
+            inst.b    = addConstant(CYX::Value(tmp->val));
+            break;
+        }
+        case Opcode::LOADD:
+        {
+            auto *tmp = static_cast<LoadD *>(vm_inst);
+            inst.a    = tmp->reg_idx;
+            inst.b    = addConstant(CYX::Value(tmp->val));
+            break;
+        }
+        case Opcode::LOADS:
+        {
+            auto *tmp = static_cast<LoadS *>(vm_inst);
+            inst.a    = tmp->reg_idx;
+            inst.b    = addConstant(CYX::Value(tmp->val));
+            break;
+        }
+        case Opcode::LOADA:
+        {
+            auto *tmp = static_cast<LoadA *>(vm_inst);
+            inst.a    = tmp->reg_idx;
+            inst.b    = addConstant(CYX::Value(tmp->array));
+            break;
+        }
+        case Opcode::LOADX:
+        {
+            auto *tmp = static_cast<LoadX *>(vm_inst);
+            inst.a    = tmp->reg_idx;
+            inst.b    = addChain(tmp->var, tmp->index);
+            break;
+        }
+        case Opcode::LOADXA:
+        {
+            auto *tmp = static_cast<LoadXA *>(vm_inst);
+            inst.a    = tmp->reg_idx;
+            inst.b    = tmp->index;
+            inst.c    = varOperand(tmp->var);
+            break;
+        }
+        case Opcode::STOREI:
+        {
+            auto *tmp = static_cast<StoreI *>(vm_inst);
+            inst.b    = varOperand(tmp->var);
+            inst.c    = addConstant(CYX::Value(tmp->val));
+            break;
+        }
+        case Opcode::STORED:
+        {
+            auto *tmp = static_cast<StoreD *>(vm_inst);
+            inst.b    = varOperand(tmp->var);
+            inst.c    = addConstant(CYX::Value(tmp->val));
+            break;
+        }
+        case Opcode::STORES:
+        {
+            auto *tmp = static_cast<StoreS *>(vm_inst);
+            inst.b    = varOperand(tmp->var);
+            inst.c    = addConstant(CYX::Value(tmp->val));
+            break;
+        }
+        case Opcode::STOREA:
+        {
+            auto *tmp = static_cast<StoreA *>(vm_inst);
+            inst.b    = addChain(tmp->var, tmp->index);
+            inst.c    = addConstant(tmp->value);
+            break;
+        }
+        case Opcode::STOREX:
+        {
+            auto *tmp = static_cast<StoreX *>(vm_inst);
+            inst.a    = tmp->reg_idx;
+            inst.b    = addChain(tmp->var, tmp->index);
+            break;
+        }
+        case Opcode::CALL:
+        case Opcode::TAILCALL:
+        {
+            auto *tmp = static_cast<Call *>(vm_inst);
+            inst.b    = tmp->target;
+            inst.c    = tmp->argc;
+            break;
+        }
+        case Opcode::FUNC:
+        {
+            auto *tmp = static_cast<Func *>(vm_inst);
+            inst.a    = tmp->param_count;
+            inst.b    = tmp->slot_count;
+            inst.c    = addName(tmp->name);
+            inst.d    = tmp->reg_count;
+            break;
+        }
+        case Opcode::ARG:
+        {
+            auto *tmp = static_cast<Arg *>(vm_inst);
+            inst.a    = static_cast<unsigned char>(tmp->type);
+            if (tmp->type == ArgType::MAP)
+                inst.b = addChain(tmp->var, tmp->index);
+            else
+                inst.b = addConstant(tmp->value);
+            break;
+        }
+        case Opcode::RET: break;
+        case Opcode::JMP: inst.b = static_cast<Jmp *>(vm_inst)->target; break;
+        case Opcode::JIF:
+        {
+            auto *tmp = static_cast<Jif *>(vm_inst);
+            inst.b    = tmp->target1;
+            inst.c    = tmp->target2;
+            break;
+        }
+        case Opcode::MOVX:
+        {
+            auto *tmp = static_cast<MovX *>(vm_inst);
+            inst.b    = varOperand(tmp->dst);
+            inst.c    = varOperand(tmp->src);
+            break;
+        }
+        default:
+        {
+            if (isArithmeticX(vm_inst->opcode))
+            {
+                auto *tmp = static_cast<ArithmeticX *>(vm_inst);
+                inst.b    = varOperand(tmp->dst);
+                inst.c    = varOperand(tmp->src1);
+                inst.d    = tmp->isImm() ? addConstant(tmp->imm) : varOperand(tmp->src2);
+                break;
+            }
+            if (isCmpJmp(vm_inst->opcode))
+            {
+                auto *tmp = static_cast<CmpJmp *>(vm_inst);
+                inst.b    = varOperand(tmp->src1);
+                inst.c    = tmp->isImm() ? addConstant(tmp->imm) : varOperand(tmp->src2);
+                inst.d    = tmp->target;
+                break;
+            }
+            UNREACHABLE();
+        }
+    }
+    return inst;
+}
+
+int CVM::Program::addConstant(const CYX::Value &value)
+{
+    constants.push_back(value);
+    return constants.size() - 1;
+}
+
+int CVM::Program::addName(const std::string &name)
+{
+    names.push_back(name);
+    return names.size() - 1;
+}
+
+int CVM::Program::addChain(const VarRef &var, const std::vector<ArrIdx> &index)
+{
+    Chain chain;
+    chain.var   = varOperand(var);
+    chain.begin = links.size();
+    for (const auto &idx : index)
+    {
+        ChainLink link;
+        if (std::holds_alternative<long long>(idx))
+            link.value = std::get<long long>(idx);
+        else
+        {
+            link.value  = varOperand(std::get<VarRef>(idx));
+            link.is_var = true;
+        }
+        links.push_back(link);
+    }
+    chain.end = links.size();
+    chains.push_back(chain);
+    return chains.size() - 1;
+}
@@ -0,0 +1,95 @@
+#ifndef CVM_PROGRAM_H
+#define CVM_PROGRAM_H
+
+#include "../common/value.hpp"
+#include "../utility/log.h"
+#include "opcode.hpp"
+#include "vm_instruction.hpp"
+
+#include <string>
+#include <vector>
+
+namespace CVM
+{
+    // fixed width instruction word, the meaning of operands depends on opcode
+    //
+    // binary         a: reg1        b: reg2
+    // LNOT/BNOT      a: reg
+    // LOADI/D/S/A    a: reg         b: constant
+    // LOADX          a: reg         b: chain
+    // LOADXA         a: reg         b: array position  c: var
+    // STOREI/D/S     b: var         c: constant
+    // STOREA         b: chain       c: constant
+    // STOREX         a: reg         b: chain
+    // CALL/TAILCALL  b: target      c: argc
+    // FUNC           a: param count b: slot count      c: name             d: register count
+    // ARG            a: ArgType     b: chain(MAP) or constant(RAW)
+    // JMP            b: target
+    // JIF            b: target1     c: target2
+    // <op>XX         b: dst var     c: var1           d: var2
+    // <op>XI         b: dst var     c: var1           d: constant
+    // J<cmp>XX       b: var1        c: var2           d: target if the comparison fails
+    // J<cmp>XI       b: var1        c: constant       d: target if the comparison fails
+    // MOVX           b: dst var     c: var
+    //
+    // var operand: slot >= 0 is a slot of the current frame, ~slot is a slot of the global frame
+    // register operand: index into the registers of the current frame, so at most 256 of them
+    struct Instruction
+    {
+        Opcode opcode{ Opcode::UNKNOWN };
+        unsigned char a{ 0 };
+        int b{ 0 };
+        int c{ 0 };
+        int d{ 0 };
+    };
+
+    // one level of an index chain, `value` is a var operand when `is_var` is set
+    struct ChainLink
+    {
+        long long value{ 0 };
+        bool is_var{ false };
+    };
+
+    // var[link][link]..., links are [begin, end) of Program::links
+    struct Chain
+    {
+        int var{ 0 };
+        int begin{ 0 };
+        int end{ 0 };
+    };
+
+    static inline int varOperand(const VarRef &var)
+    {
+        return var.global ? ~var.slot : var.slot;
+    }
+
+    // executable image of the VM, built from VMInstruction
+    class Program
+    {
+      public:
+        void assemble(const std::vector<VMInstruction *> &insts);
+        // place a function behind the code and return its position, its jump targets are relative to its FUNC
+        int append(const std::vector<VMInstruction *> &insts);
+
+      private:
+        Instruction translate(VMInstruction *vm_inst);
+        int addConstant(const CYX::Value &value);
+        int addName(const std::string &name);
+        int addChain(const VarRef &var, const std::vector<ArrIdx> &index);
+
+      public:
+        std::vector<Instruction> code;
+        std::vector<CYX::Value> constants;
+        std::vector<std::string> names;
+        std::vector<Chain> chains;
+        std::vector<ChainLink> links;
+        //
+        int entry{ 0 };             // main function position
+        int entry_end{ 0 };         // main function end
+        int global_var_len{ 0 };    // global data initialize instruction length
+        int global_slot_count{ 0 }; // global frame size
+        int global_reg_count{ 0 };  // global frame registers
+    };
+} // namespace CVM
+
+#endif // CVM_PROGRAM_H
@@ -0,0 +1,42 @@
+#ifndef CVM_TIER_H
+#define CVM_TIER_H
+
+#include "vm_instruction.hpp"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace CVM
+{
+    // optimized version of the function at FUNC position `func`.
+    // its jump targets are relative to its FUNC, its call targets are FUNC positions of the program it was made for.
+    struct Recompiled
+    {
+        int func{ -1 };
+        std::vector<VMInstruction *> insts;
+    };
+
+    // second execution tier: the VM starts from quickly compiled bytecode and hands every function that gets hot to
+    // a Recompiler, which optimizes it away from the VM thread.
+    // the VM links a finished version at its next call boundary, frames already running stay in the old code.
+    class Recompiler
+    {
+      public:
+        virtual ~Recompiler() = default;
+        // queue the function at FUNC position `func`, never blocks
+        virtual void request(int func, const std::string &name) = 0;
+        // take one finished version, false if there is none
+        virtual bool poll(Recompiled &result) = 0;
+        // something to poll, cheap enough for every call
+        bool ready() const
+        {
+            return finished.load(std::memory_order_acquire) > 0;
+        }
+
+      protected:
+        std::atomic<int> finished{ 0 }; // finished versions not polled yet
+    };
+} // namespace CVM
+
+#endif // CVM_TIER_H
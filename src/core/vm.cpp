@@ -1,350 +1,889 @@
 #include "vm.hpp"
 
+using Tag = CYX::Value::Tag;
+
+static inline bool isIntPair(const CYX::Value &lhs, const CYX::Value &rhs)
+{
+    return lhs.type() == Tag::INT && rhs.type() == Tag::INT;
+}
+
+// what Value computes in double: ints or doubles, at least one double
+static inline bool isDoublePair(const CYX::Value &lhs, const CYX::Value &rhs)
+{
+    const auto l = lhs.type();
+    const auto r = rhs.type();
+    if (l != Tag::DOUBLE && r != Tag::DOUBLE) return false;
+    return (l == Tag::INT || l == Tag::DOUBLE) && (r == Tag::INT || r == Tag::DOUBLE);
+}
+
+static inline bool isStringPair(const CYX::Value &lhs, const CYX::Value &rhs)
+{
+    return lhs.type() == Tag::STRING && rhs.type() == Tag::STRING;
+}
+
+static inline double toDouble(const CYX::Value &value)
+{
+    return value.type() == Tag::INT ? static_cast<double>(value.value<long long>()) : value.value<double>();
+}
+
+// the specialized opcode for the observed operand types, UNKNOWN if there is none
+static inline CVM::Opcode quickenedOpcode(const CYX::Value &lhs, const CYX::Value &rhs, CVM::Opcode int_op,
+                                          CVM::Opcode double_op, CVM::Opcode string_op)
+{
+    if (isIntPair(lhs, rhs)) return int_op;
+    if (isDoublePair(lhs, rhs)) return double_op;
+    if (isStringPair(lhs, rhs)) return string_op;
+    return CVM::Opcode::UNKNOWN;
+}
+
 void CVM::VM::run()
 {
-    while (fetch())
+    // no frame is moved or reallocated by CALL, except for very deep recursion
+    frame.reserve(std::min(max_call_depth, DEFAULT_MAX_CALL_DEPTH) + 1);
+    stack.resize(256);
+    auto *prev_output = CYX::bindOutput(output);
+    auto *prev_input  = CYX::bindInput(input);
+    // global var decl
+    pushFrame(program.global_slot_count, program.global_reg_count);
+    execute(0, program.global_var_len);
+    pushFrame(program.code[program.entry].b, program.code[program.entry].d);
+    execute(program.entry, program.entry_end);
+    CYX::output().flush();
+    CYX::bindOutput(prev_output);
+    CYX::bindInput(prev_input);
+}
+
+// One handler per opcode. The handler bodies are shared by both dispatch modes:
+// with CYX_COMPUTED_GOTO every instruction jumps straight to the handler of the next one(direct threading),
+// otherwise it is a plain switch loop.
+void CVM::VM::execute(int begin, int end)
+{
+#define STATE reg[STATE_REGISTER]
+#define BINARY(OP)                                                                                                     \
+    {                                                                                                                  \
+        reg[cur_inst->a] = reg[cur_inst->a] OP reg[cur_inst->b];                                                       \
+        NEXT();                                                                                                        \
+    }
+#define COMPARE(OP)                                                                                                    \
+    {                                                                                                                  \
+        STATE = reg[cur_inst->a] OP reg[cur_inst->b];                                                                  \
+        NEXT();                                                                                                        \
+    }
+#define LOAD()                                                                                                         \
+    {                                                                                                                  \
+        reg[cur_inst->a] = program.constants[cur_inst->b];                                                             \
+        NEXT();                                                                                                        \
+    }
+#define STORE()                                                                                                        \
+    {                                                                                                                  \
+        symbol(frame.back(), cur_inst->b) = program.constants[cur_inst->c];                                            \
+        NEXT();                                                                                                        \
+    }
+#define BINARY_XX(OP)                                                                                                  \
+    {                                                                                                                  \
+        auto &cur_frame                = frame.back();                                                                 \
+        symbol(cur_frame, cur_inst->b) = symbol(cur_frame, cur_inst->c) OP symbol(cur_frame, cur_inst->d);             \
+        NEXT();                                                                                                        \
+    }
+#define BINARY_XI(OP)                                                                                                  \
+    {                                                                                                                  \
+        auto &cur_frame                = frame.back();                                                                 \
+        symbol(cur_frame, cur_inst->b) = symbol(cur_frame, cur_inst->c) OP program.constants[cur_inst->d];             \
+        NEXT();                                                                                                        \
+    }
+#define CMP_JMP_XX(OP)                                                                                                 \
+    {                                                                                                                  \
+        auto &cur_frame = frame.back();                                                                                \
+        if (symbol(cur_frame, cur_inst->b) OP symbol(cur_frame, cur_inst->c)) NEXT();                                  \
+        pc = cur_inst->d;                                                                                              \
+        DISPATCH_TARGET();                                                                                             \
+    }
+#define CMP_JMP_XI(OP)                                                                                                 \
+    {                                                                                                                  \
+        if (symbol(frame.back(), cur_inst->b) OP program.constants[cur_inst->c]) NEXT();                               \
+        pc = cur_inst->d;                                                                                              \
+        DISPATCH_TARGET();                                                                                             \
+    }
+
+// type feedback: a generic handler records the operand types of its site and rewrites the site to a specialized
+// handler, which guards the types and deoptimizes back to the generic one on a miss.
+// a site that keeps missing stays generic.
+#define REG_A reg[cur_inst->a]
+#define REG_B reg[cur_inst->b]
+#define VAR_B symbol(frame.back(), cur_inst->b)
+#define VAR_C symbol(frame.back(), cur_inst->c)
+#define VAR_D symbol(frame.back(), cur_inst->d)
+#define CONST_C program.constants[cur_inst->c]
+#define CONST_D program.constants[cur_inst->d]
+#define AS_INT(X) (X).value<long long>()
+#define AS_DOUBLE(X) toDouble(X)
+#define AS_STRING(X) (X).value<std::string>()
+#define QUICKEN(LHS, RHS, INT_OP, DOUBLE_OP, STRING_OP)                                                                \
+    if (site_misses[pc] < MAX_QUICKEN_MISSES)                                                                          \
+    {                                                                                                                  \
+        const auto quickened = quickenedOpcode(LHS, RHS, Opcode::INT_OP, Opcode::DOUBLE_OP, Opcode::STRING_OP);        \
+        if (quickened != Opcode::UNKNOWN)                                                                              \
+            REWRITE(quickened);                                                                                        \
+        else                                                                                                           \
+            site_misses[pc]++;                                                                                         \
+    }
+#define DEOPT(GENERIC)                                                                                                 \
+    {                                                                                                                  \
+        REWRITE(Opcode::GENERIC);                                                                                      \
+        site_misses[pc]++;                                                                                             \
+        DISPATCH_TARGET();                                                                                             \
+    }
+#define SPECIALIZE(GUARD, LHS, RHS, RESULT, GENERIC)                                                                   \
+    {                                                                                                                  \
+        const auto &lhs = LHS;                                                                                         \
+        const auto &rhs = RHS;                                                                                         \
+        if (GUARD(lhs, rhs))                                                                                           \
+        {                                                                                                              \
+            RESULT;                                                                                                    \
+            NEXT();                                                                                                    \
+        }                                                                                                              \
+        DEOPT(GENERIC)                                                                                                 \
+    }
+#define SPECIALIZE_JMP(GUARD, LHS, RHS, COND, GENERIC)                                                                 \
+    {                                                                                                                  \
+        const auto &lhs = LHS;                                                                                         \
+        const auto &rhs = RHS;                                                                                         \
+        if (GUARD(lhs, rhs))                                                                                           \
+        {                                                                                                              \
+            if (COND) NEXT();                                                                                          \
+            pc = cur_inst->d;                                                                                          \
+            DISPATCH_TARGET();                                                                                         \
+        }                                                                                                              \
+        DEOPT(GENERIC)                                                                                                 \
+    }
+#define ARITH_AS(GUARD, AS, LHS, RHS, DST, OP, GENERIC)                                                               \
+    SPECIALIZE(GUARD, LHS, RHS, DST = CYX::Value(AS(lhs) OP AS(rhs)), GENERIC)
+#define COMPARE_AS(GUARD, AS, OP, GENERIC) SPECIALIZE(GUARD, REG_A, REG_B, STATE = AS(lhs) OP AS(rhs), GENERIC)
+#define CMP_JMP_AS(GUARD, AS, LHS, RHS, OP, GENERIC) SPECIALIZE_JMP(GUARD, LHS, RHS, AS(lhs) OP AS(rhs), GENERIC)
+
+    // a frame below this depth belongs to the caller of `execute`
+    const auto depth = frame.size();
+    pc               = begin;
+#ifdef CYX_COMPUTED_GOTO
+    // same order as Opcode
+    static const void *const handlers[] = {
+        &&L_ADD,    &&L_SUB,    &&L_MUL,    &&L_DIV,    &&L_MOD,    &&L_EXP,   &&L_BAND,   &&L_BOR,
+        &&L_BXOR,   &&L_SHL,    &&L_SHR,    &&L_LOR,    &&L_NE,     &&L_EQ,    &&L_LT,     &&L_LE,
+        &&L_GT,     &&L_GE,     &&L_LAND,   &&L_LNOT,   &&L_BNOT,   &&L_LOADI, &&L_LOADD,  &&L_LOADS,
+        &&L_LOADA,  &&L_LOADX,  &&L_LOADXA, &&L_STOREI, &&L_STORED, &&L_STORES, &&L_STOREA, &&L_STOREX,
+        &&L_CALL,   &&L_FUNC,   &&L_ARG,    &&L_RET,    &&L_JMP,    &&L_JIF,    &&L_ADDXX,  &&L_SUBXX,
+        &&L_MULXX,  &&L_DIVXX,  &&L_MODXX,  &&L_ADDXI,  &&L_SUBXI,  &&L_MULXI,  &&L_DIVXI,  &&L_MODXI,
+        &&L_JNEXX,  &&L_JEQXX,  &&L_JLTXX,  &&L_JLEXX,  &&L_JGTXX,  &&L_JGEXX,  &&L_JNEXI,  &&L_JEQXI,
+        &&L_JLTXI,  &&L_JLEXI,  &&L_JGTXI,  &&L_JGEXI,  &&L_MOVX,   &&L_TAILCALL,
+        &&L_ADD_INT,         &&L_SUB_INT,         &&L_MUL_INT,         &&L_DIV_INT,         &&L_MOD_INT,
+        &&L_NE_INT,          &&L_EQ_INT,          &&L_LT_INT,          &&L_LE_INT,          &&L_GT_INT,
+        &&L_GE_INT,          &&L_ADDXX_INT,       &&L_SUBXX_INT,       &&L_MULXX_INT,       &&L_DIVXX_INT,
+        &&L_MODXX_INT,       &&L_ADDXI_INT,       &&L_SUBXI_INT,       &&L_MULXI_INT,       &&L_DIVXI_INT,
+        &&L_MODXI_INT,       &&L_JNEXX_INT,       &&L_JEQXX_INT,       &&L_JLTXX_INT,       &&L_JLEXX_INT,
+        &&L_JGTXX_INT,       &&L_JGEXX_INT,       &&L_JNEXI_INT,       &&L_JEQXI_INT,       &&L_JLTXI_INT,
+        &&L_JLEXI_INT,       &&L_JGTXI_INT,       &&L_JGEXI_INT,       &&L_ADD_DOUBLE,      &&L_SUB_DOUBLE,
+        &&L_MUL_DOUBLE,      &&L_DIV_DOUBLE,      &&L_NE_DOUBLE,       &&L_EQ_DOUBLE,       &&L_LT_DOUBLE,
+        &&L_LE_DOUBLE,       &&L_GT_DOUBLE,       &&L_GE_DOUBLE,       &&L_ADDXX_DOUBLE,    &&L_SUBXX_DOUBLE,
+        &&L_MULXX_DOUBLE,    &&L_DIVXX_DOUBLE,    &&L_ADDXI_DOUBLE,    &&L_SUBXI_DOUBLE,    &&L_MULXI_DOUBLE,
+        &&L_DIVXI_DOUBLE,    &&L_JNEXX_DOUBLE,    &&L_JEQXX_DOUBLE,    &&L_JLTXX_DOUBLE,    &&L_JLEXX_DOUBLE,
+        &&L_JGTXX_DOUBLE,    &&L_JGEXX_DOUBLE,    &&L_JNEXI_DOUBLE,    &&L_JEQXI_DOUBLE,    &&L_JLTXI_DOUBLE,
+        &&L_JLEXI_DOUBLE,    &&L_JGTXI_DOUBLE,    &&L_JGEXI_DOUBLE,    &&L_ADD_STRING,      &&L_ADDXX_STRING,
+    };
+    static_assert(sizeof(handlers) / sizeof(handlers[0]) ==
+                      opcode2UChar(Opcode::ADDXX_STRING) - opcode2UChar(Opcode::ADD) + 1,
+                  "handler table is out of sync with Opcode");
+    // one extra slot, so `end` can always be patched.
+    // code linked by tiering only adds handlers, the existing ones and their halt patches stay
+    auto translate = [this]()
+    {
+        if (threaded_code.size() == program.code.size() + 1) return;
+        const int from = threaded_code.empty() ? 0 : threaded_code.size() - 1;
+        threaded_code.resize(program.code.size() + 1, nullptr);
+        for (int i = from; i < program.code.size(); i++)
+        {
+            const auto op = opcode2UChar(program.code[i].opcode);
+            if (op < opcode2UChar(Opcode::ADD) || op > opcode2UChar(Opcode::ADDXX_STRING)) UNREACHABLE();
+            threaded_code[i] = handlers[op - opcode2UChar(Opcode::ADD)];
+        }
+    };
+    translate();
+    // instruction at `end` is not executed, its slot works as halt
+    const void *end_handler = end >= 0 ? threaded_code[end] : nullptr;
+    if (end >= 0) threaded_code[end] = &&L_HALT;
+    #define CASE(OP) L_##OP:
+    #define DISPATCH()                                                                                                 \
+        do                                                                                                             \
+        {                                                                                                              \
+            cur_inst = &program.code[pc];                                                                              \
+            goto *threaded_code[pc];                                                                                   \
+        } while (false)
+    #define NEXT()                                                                                                     \
+        do                                                                                                             \
+        {                                                                                                              \
+            pc++;                                                                                                      \
+            DISPATCH();                                                                                                \
+        } while (false)
+    #define DISPATCH_TARGET() DISPATCH()
+    #define REWRITE(OP)                                                                                                \
+        do                                                                                                             \
+        {                                                                                                              \
+            program.code[pc].opcode = (OP);                                                                            \
+            threaded_code[pc]       = handlers[opcode2UChar(OP) - opcode2UChar(Opcode::ADD)];                          \
+        } while (false)
+
+    DISPATCH();
+#else
+    #define CASE(OP) case Opcode::OP:
+    #define NEXT()                                                                                                     \
+        {                                                                                                              \
+            pc++;                                                                                                      \
+            continue;                                                                                                  \
+        }
+    #define DISPATCH_TARGET() continue
+    #define REWRITE(OP) (program.code[pc].opcode = (OP))
+
+    while (pc != end)
     {
+        cur_inst = &program.code[pc];
         switch (cur_inst->opcode)
         {
-            case Opcode::ADD:
-            case Opcode::SUB:
-            case Opcode::MUL:
-            case Opcode::DIV:
-            case Opcode::MOD:
-            case Opcode::EXP:
-            case Opcode::BAND:
-            case Opcode::BOR:
-            case Opcode::BXOR:
-            case Opcode::SHL:
-            case Opcode::SHR:
-            case Opcode::LOR:
-            case Opcode::NE:
-            case Opcode::EQ:
-            case Opcode::LT:
-            case Opcode::LE:
-            case Opcode::GT:
-            case Opcode::GE:
-            case Opcode::LAND: binary(); break;
-            case Opcode::LNOT:
-            case Opcode::BNOT: unary(); break;
-            case Opcode::LOADI:
-            case Opcode::LOADD:
-            case Opcode::LOADA:
-            case Opcode::LOADS: load(); break;
-            case Opcode::LOADX: loadX(); break;
-            case Opcode::LOADXA: loadXA(); break;
-            case Opcode::STOREI:
-            case Opcode::STORED:
-            case Opcode::STORES:
-            case Opcode::STOREA: store(); break;
-            case Opcode::STOREX: storeX(); break;
-            case Opcode::CALL: call(); break;
-            case Opcode::FUNC: break;
-            case Opcode::ARG: arg(); break;
-            case Opcode::PARAM: param(); break;
-            case Opcode::RET: ret(); break;
-            case Opcode::JMP: jmp(); break;
-            case Opcode::JIF: jif(); break;
+#endif
+            CASE(ADD)
+            {
+                QUICKEN(REG_A, REG_B, ADD_INT, ADD_DOUBLE, ADD_STRING)
+                BINARY(+)
+            }
+            CASE(SUB)
+            {
+                QUICKEN(REG_A, REG_B, SUB_INT, SUB_DOUBLE, UNKNOWN)
+                BINARY(-)
+            }
+            CASE(MUL)
+            {
+                QUICKEN(REG_A, REG_B, MUL_INT, MUL_DOUBLE, UNKNOWN)
+                BINARY(*)
+            }
+            CASE(DIV)
+            {
+                QUICKEN(REG_A, REG_B, DIV_INT, DIV_DOUBLE, UNKNOWN)
+                BINARY(/)
+            }
+            CASE(MOD)
+            {
+                QUICKEN(REG_A, REG_B, MOD_INT, UNKNOWN, UNKNOWN)
+                BINARY(%)
+            }
+            CASE(BAND) BINARY(&)
+            CASE(BOR) BINARY(|)
+            CASE(BXOR) BINARY(^)
+            CASE(SHL) BINARY(<<)
+            CASE(SHR) BINARY(>>)
+            CASE(EXP)
+            {
+                reg[cur_inst->a] = reg[cur_inst->a].power(reg[cur_inst->b]);
+                NEXT();
+            }
+            CASE(LOR) COMPARE(||)
+            CASE(LAND) COMPARE(&&)
+            CASE(NE)
+            {
+                QUICKEN(REG_A, REG_B, NE_INT, NE_DOUBLE, UNKNOWN)
+                COMPARE(!=)
+            }
+            CASE(EQ)
+            {
+                QUICKEN(REG_A, REG_B, EQ_INT, EQ_DOUBLE, UNKNOWN)
+                COMPARE(==)
+            }
+            CASE(LT)
+            {
+                QUICKEN(REG_A, REG_B, LT_INT, LT_DOUBLE, UNKNOWN)
+                COMPARE(<)
+            }
+            CASE(LE)
+            {
+                QUICKEN(REG_A, REG_B, LE_INT, LE_DOUBLE, UNKNOWN)
+                COMPARE(<=)
+            }
+            CASE(GT)
+            {
+                QUICKEN(REG_A, REG_B, GT_INT, GT_DOUBLE, UNKNOWN)
+                COMPARE(>)
+            }
+            CASE(GE)
+            {
+                QUICKEN(REG_A, REG_B, GE_INT, GE_DOUBLE, UNKNOWN)
+                COMPARE(>=)
+            }
+            CASE(LNOT)
+            {
+                auto &target = reg[cur_inst->a];
+                target       = !target;
+                NEXT();
+            }
+            CASE(BNOT)
+            {
+                auto &target = reg[cur_inst->a];
+                target       = ~target;
+                NEXT();
+            }
+            CASE(LOADI) LOAD()
+            CASE(LOADD) LOAD()
+            CASE(LOADS) LOAD()
+            CASE(LOADA) LOAD()
+            CASE(LOADX)
+            {
+                reg[cur_inst->a] = fetch(frame.back(), cur_inst->b);
+                NEXT();
+            }
+            CASE(LOADXA)
+            {
+                reg[cur_inst->a][cur_inst->b] = symbol(frame.back(), cur_inst->c);
+                NEXT();
+            }
+            CASE(STOREI) STORE()
+            CASE(STORED) STORE()
+            CASE(STORES) STORE()
+            CASE(STOREA)
+            {
+                *locate(frame.back(), cur_inst->b) = program.constants[cur_inst->c];
+                NEXT();
+            }
+            CASE(STOREX)
+            {
+                *locate(frame.back(), cur_inst->b) = reg[cur_inst->a];
+                NEXT();
+            }
+            CASE(CALL)
+            {
+                call();
+#ifdef CYX_COMPUTED_GOTO
+                translate();
+#endif
+                NEXT();
+            }
+            CASE(TAILCALL)
+            {
+                tailCall();
+                if (frame.size() < depth) goto L_HALT;
+#ifdef CYX_COMPUTED_GOTO
+                translate();
+#endif
+                NEXT();
+            }
+            CASE(FUNC) NEXT();
+            CASE(ARG)
+            {
+                arg();
+                NEXT();
+            }
+            CASE(RET)
+            {
+                ret();
+                if (frame.size() < depth) goto L_HALT;
+                NEXT();
+            }
+            CASE(JMP)
+            {
+                if (cur_inst->b < pc && owner[pc] >= 0)
+                {
+                    const auto func = owner[pc];
+                    heat(func);
+#ifdef CYX_JIT
+                    // a hot loop leaves the interpreter at its header(on-stack replacement), finishing like RET
+                    if (hotness[func] >= JIT_THRESHOLD && jit.compilable(func) &&
+                        jit.enterLoop(this, func, cur_inst->b))
+                    {
+                        if (frame.size() < depth) goto L_HALT;
+                        NEXT();
+                    }
+#endif
+                }
+                pc = cur_inst->b;
+                DISPATCH_TARGET();
+            }
+            CASE(JIF)
+            {
+                pc    = STATE ? cur_inst->b : cur_inst->c;
+                STATE = false;
+                DISPATCH_TARGET();
+            }
+            CASE(ADDXX)
+            {
+                QUICKEN(VAR_C, VAR_D, ADDXX_INT, ADDXX_DOUBLE, ADDXX_STRING)
+                // `+` appends to an array operand in place, so work on copies like the register version
+                auto &cur_frame = frame.back();
+                CYX::Value lhs  = symbol(cur_frame, cur_inst->c);
+                CYX::Value rhs  = symbol(cur_frame, cur_inst->d);
+                symbol(cur_frame, cur_inst->b) = lhs + rhs;
+                NEXT();
+            }
+            CASE(SUBXX)
+            {
+                QUICKEN(VAR_C, VAR_D, SUBXX_INT, SUBXX_DOUBLE, UNKNOWN)
+                BINARY_XX(-)
+            }
+            CASE(MULXX)
+            {
+                QUICKEN(VAR_C, VAR_D, MULXX_INT, MULXX_DOUBLE, UNKNOWN)
+                BINARY_XX(*)
+            }
+            CASE(DIVXX)
+            {
+                QUICKEN(VAR_C, VAR_D, DIVXX_INT, DIVXX_DOUBLE, UNKNOWN)
+                BINARY_XX(/)
+            }
+            CASE(MODXX)
+            {
+                QUICKEN(VAR_C, VAR_D, MODXX_INT, UNKNOWN, UNKNOWN)
+                BINARY_XX(%)
+            }
+            CASE(ADDXI)
+            {
+                QUICKEN(VAR_C, CONST_D, ADDXI_INT, ADDXI_DOUBLE, UNKNOWN)
+                auto &cur_frame = frame.back();
+                CYX::Value lhs  = symbol(cur_frame, cur_inst->c);
+                symbol(cur_frame, cur_inst->b) = lhs + program.constants[cur_inst->d];
+                NEXT();
+            }
+            CASE(SUBXI)
+            {
+                QUICKEN(VAR_C, CONST_D, SUBXI_INT, SUBXI_DOUBLE, UNKNOWN)
+                BINARY_XI(-)
+            }
+            CASE(MULXI)
+            {
+                QUICKEN(VAR_C, CONST_D, MULXI_INT, MULXI_DOUBLE, UNKNOWN)
+                BINARY_XI(*)
+            }
+            CASE(DIVXI)
+            {
+                QUICKEN(VAR_C, CONST_D, DIVXI_INT, DIVXI_DOUBLE, UNKNOWN)
+                BINARY_XI(/)
+            }
+            CASE(MODXI)
+            {
+                QUICKEN(VAR_C, CONST_D, MODXI_INT, UNKNOWN, UNKNOWN)
+                BINARY_XI(%)
+            }
+            CASE(JNEXX)
+            {
+                QUICKEN(VAR_B, VAR_C, JNEXX_INT, JNEXX_DOUBLE, UNKNOWN)
+                CMP_JMP_XX(!=)
+            }
+            CASE(JEQXX)
+            {
+                QUICKEN(VAR_B, VAR_C, JEQXX_INT, JEQXX_DOUBLE, UNKNOWN)
+                CMP_JMP_XX(==)
+            }
+            CASE(JLTXX)
+            {
+                QUICKEN(VAR_B, VAR_C, JLTXX_INT, JLTXX_DOUBLE, UNKNOWN)
+                CMP_JMP_XX(<)
+            }
+            CASE(JLEXX)
+            {
+                QUICKEN(VAR_B, VAR_C, JLEXX_INT, JLEXX_DOUBLE, UNKNOWN)
+                CMP_JMP_XX(<=)
+            }
+            CASE(JGTXX)
+            {
+                QUICKEN(VAR_B, VAR_C, JGTXX_INT, JGTXX_DOUBLE, UNKNOWN)
+                CMP_JMP_XX(>)
+            }
+            CASE(JGEXX)
+            {
+                QUICKEN(VAR_B, VAR_C, JGEXX_INT, JGEXX_DOUBLE, UNKNOWN)
+                CMP_JMP_XX(>=)
+            }
+            CASE(JNEXI)
+            {
+                QUICKEN(VAR_B, CONST_C, JNEXI_INT, JNEXI_DOUBLE, UNKNOWN)
+                CMP_JMP_XI(!=)
+            }
+            CASE(JEQXI)
+            {
+                QUICKEN(VAR_B, CONST_C, JEQXI_INT, JEQXI_DOUBLE, UNKNOWN)
+                CMP_JMP_XI(==)
+            }
+            CASE(JLTXI)
+            {
+                QUICKEN(VAR_B, CONST_C, JLTXI_INT, JLTXI_DOUBLE, UNKNOWN)
+                CMP_JMP_XI(<)
+            }
+            CASE(JLEXI)
+            {
+                QUICKEN(VAR_B, CONST_C, JLEXI_INT, JLEXI_DOUBLE, UNKNOWN)
+                CMP_JMP_XI(<=)
+            }
+            CASE(JGTXI)
+            {
+                QUICKEN(VAR_B, CONST_C, JGTXI_INT, JGTXI_DOUBLE, UNKNOWN)
+                CMP_JMP_XI(>)
+            }
+            CASE(JGEXI)
+            {
+                QUICKEN(VAR_B, CONST_C, JGEXI_INT, JGEXI_DOUBLE, UNKNOWN)
+                CMP_JMP_XI(>=)
+            }
+            CASE(MOVX)
+            {
+                auto &cur_frame                = frame.back();
+                symbol(cur_frame, cur_inst->b) = symbol(cur_frame, cur_inst->c);
+                NEXT();
+            }
+            CASE(ADD_INT) ARITH_AS(isIntPair, AS_INT, REG_A, REG_B, REG_A, +, ADD)
+            CASE(SUB_INT) ARITH_AS(isIntPair, AS_INT, REG_A, REG_B, REG_A, -, SUB)
+            CASE(MUL_INT) ARITH_AS(isIntPair, AS_INT, REG_A, REG_B, REG_A, *, MUL)
+            CASE(DIV_INT) ARITH_AS(isIntPair, AS_INT, REG_A, REG_B, REG_A, /, DIV)
+            CASE(MOD_INT) ARITH_AS(isIntPair, AS_INT, REG_A, REG_B, REG_A, %, MOD)
+            CASE(NE_INT) COMPARE_AS(isIntPair, AS_INT, !=, NE)
+            CASE(EQ_INT) COMPARE_AS(isIntPair, AS_INT, ==, EQ)
+            CASE(LT_INT) COMPARE_AS(isIntPair, AS_INT, <, LT)
+            CASE(LE_INT) COMPARE_AS(isIntPair, AS_INT, <=, LE)
+            CASE(GT_INT) COMPARE_AS(isIntPair, AS_INT, >, GT)
+            CASE(GE_INT) COMPARE_AS(isIntPair, AS_INT, >=, GE)
+            CASE(ADDXX_INT) ARITH_AS(isIntPair, AS_INT, VAR_C, VAR_D, VAR_B, +, ADDXX)
+            CASE(SUBXX_INT) ARITH_AS(isIntPair, AS_INT, VAR_C, VAR_D, VAR_B, -, SUBXX)
+            CASE(MULXX_INT) ARITH_AS(isIntPair, AS_INT, VAR_C, VAR_D, VAR_B, *, MULXX)
+            CASE(DIVXX_INT) ARITH_AS(isIntPair, AS_INT, VAR_C, VAR_D, VAR_B, /, DIVXX)
+            CASE(MODXX_INT) ARITH_AS(isIntPair, AS_INT, VAR_C, VAR_D, VAR_B, %, MODXX)
+            CASE(ADDXI_INT) ARITH_AS(isIntPair, AS_INT, VAR_C, CONST_D, VAR_B, +, ADDXI)
+            CASE(SUBXI_INT) ARITH_AS(isIntPair, AS_INT, VAR_C, CONST_D, VAR_B, -, SUBXI)
+            CASE(MULXI_INT) ARITH_AS(isIntPair, AS_INT, VAR_C, CONST_D, VAR_B, *, MULXI)
+            CASE(DIVXI_INT) ARITH_AS(isIntPair, AS_INT, VAR_C, CONST_D, VAR_B, /, DIVXI)
+            CASE(MODXI_INT) ARITH_AS(isIntPair, AS_INT, VAR_C, CONST_D, VAR_B, %, MODXI)
+            CASE(JNEXX_INT) CMP_JMP_AS(isIntPair, AS_INT, VAR_B, VAR_C, !=, JNEXX)
+            CASE(JEQXX_INT) CMP_JMP_AS(isIntPair, AS_INT, VAR_B, VAR_C, ==, JEQXX)
+            CASE(JLTXX_INT) CMP_JMP_AS(isIntPair, AS_INT, VAR_B, VAR_C, <, JLTXX)
+            CASE(JLEXX_INT) CMP_JMP_AS(isIntPair, AS_INT, VAR_B, VAR_C, <=, JLEXX)
+            CASE(JGTXX_INT) CMP_JMP_AS(isIntPair, AS_INT, VAR_B, VAR_C, >, JGTXX)
+            CASE(JGEXX_INT) CMP_JMP_AS(isIntPair, AS_INT, VAR_B, VAR_C, >=, JGEXX)
+            CASE(JNEXI_INT) CMP_JMP_AS(isIntPair, AS_INT, VAR_B, CONST_C, !=, JNEXI)
+            CASE(JEQXI_INT) CMP_JMP_AS(isIntPair, AS_INT, VAR_B, CONST_C, ==, JEQXI)
+            CASE(JLTXI_INT) CMP_JMP_AS(isIntPair, AS_INT, VAR_B, CONST_C, <, JLTXI)
+            CASE(JLEXI_INT) CMP_JMP_AS(isIntPair, AS_INT, VAR_B, CONST_C, <=, JLEXI)
+            CASE(JGTXI_INT) CMP_JMP_AS(isIntPair, AS_INT, VAR_B, CONST_C, >, JGTXI)
+            CASE(JGEXI_INT) CMP_JMP_AS(isIntPair, AS_INT, VAR_B, CONST_C, >=, JGEXI)
+            CASE(ADD_DOUBLE) ARITH_AS(isDoublePair, AS_DOUBLE, REG_A, REG_B, REG_A, +, ADD)
+            CASE(SUB_DOUBLE) ARITH_AS(isDoublePair, AS_DOUBLE, REG_A, REG_B, REG_A, -, SUB)
+            CASE(MUL_DOUBLE) ARITH_AS(isDoublePair, AS_DOUBLE, REG_A, REG_B, REG_A, *, MUL)
+            CASE(DIV_DOUBLE) ARITH_AS(isDoublePair, AS_DOUBLE, REG_A, REG_B, REG_A, /, DIV)
+            CASE(NE_DOUBLE) COMPARE_AS(isDoublePair, AS_DOUBLE, !=, NE)
+            CASE(EQ_DOUBLE) COMPARE_AS(isDoublePair, AS_DOUBLE, ==, EQ)
+            CASE(LT_DOUBLE) COMPARE_AS(isDoublePair, AS_DOUBLE, <, LT)
+            CASE(LE_DOUBLE) COMPARE_AS(isDoublePair, AS_DOUBLE, <=, LE)
+            CASE(GT_DOUBLE) COMPARE_AS(isDoublePair, AS_DOUBLE, >, GT)
+            CASE(GE_DOUBLE) COMPARE_AS(isDoublePair, AS_DOUBLE, >=, GE)
+            CASE(ADDXX_DOUBLE) ARITH_AS(isDoublePair, AS_DOUBLE, VAR_C, VAR_D, VAR_B, +, ADDXX)
+            CASE(SUBXX_DOUBLE) ARITH_AS(isDoublePair, AS_DOUBLE, VAR_C, VAR_D, VAR_B, -, SUBXX)
+            CASE(MULXX_DOUBLE) ARITH_AS(isDoublePair, AS_DOUBLE, VAR_C, VAR_D, VAR_B, *, MULXX)
+            CASE(DIVXX_DOUBLE) ARITH_AS(isDoublePair, AS_DOUBLE, VAR_C, VAR_D, VAR_B, /, DIVXX)
+            CASE(ADDXI_DOUBLE) ARITH_AS(isDoublePair, AS_DOUBLE, VAR_C, CONST_D, VAR_B, +, ADDXI)
+            CASE(SUBXI_DOUBLE) ARITH_AS(isDoublePair, AS_DOUBLE, VAR_C, CONST_D, VAR_B, -, SUBXI)
+            CASE(MULXI_DOUBLE) ARITH_AS(isDoublePair, AS_DOUBLE, VAR_C, CONST_D, VAR_B, *, MULXI)
+            CASE(DIVXI_DOUBLE) ARITH_AS(isDoublePair, AS_DOUBLE, VAR_C, CONST_D, VAR_B, /, DIVXI)
+            CASE(JNEXX_DOUBLE) CMP_JMP_AS(isDoublePair, AS_DOUBLE, VAR_B, VAR_C, !=, JNEXX)
+            CASE(JEQXX_DOUBLE) CMP_JMP_AS(isDoublePair, AS_DOUBLE, VAR_B, VAR_C, ==, JEQXX)
+            CASE(JLTXX_DOUBLE) CMP_JMP_AS(isDoublePair, AS_DOUBLE, VAR_B, VAR_C, <, JLTXX)
+            CASE(JLEXX_DOUBLE) CMP_JMP_AS(isDoublePair, AS_DOUBLE, VAR_B, VAR_C, <=, JLEXX)
+            CASE(JGTXX_DOUBLE) CMP_JMP_AS(isDoublePair, AS_DOUBLE, VAR_B, VAR_C, >, JGTXX)
+            CASE(JGEXX_DOUBLE) CMP_JMP_AS(isDoublePair, AS_DOUBLE, VAR_B, VAR_C, >=, JGEXX)
+            CASE(JNEXI_DOUBLE) CMP_JMP_AS(isDoublePair, AS_DOUBLE, VAR_B, CONST_C, !=, JNEXI)
+            CASE(JEQXI_DOUBLE) CMP_JMP_AS(isDoublePair, AS_DOUBLE, VAR_B, CONST_C, ==, JEQXI)
+            CASE(JLTXI_DOUBLE) CMP_JMP_AS(isDoublePair, AS_DOUBLE, VAR_B, CONST_C, <, JLTXI)
+            CASE(JLEXI_DOUBLE) CMP_JMP_AS(isDoublePair, AS_DOUBLE, VAR_B, CONST_C, <=, JLEXI)
+            CASE(JGTXI_DOUBLE) CMP_JMP_AS(isDoublePair, AS_DOUBLE, VAR_B, CONST_C, >, JGTXI)
+            CASE(JGEXI_DOUBLE) CMP_JMP_AS(isDoublePair, AS_DOUBLE, VAR_B, CONST_C, >=, JGEXI)
+            CASE(ADD_STRING) ARITH_AS(isStringPair, AS_STRING, REG_A, REG_B, REG_A, +, ADD)
+            CASE(ADDXX_STRING) ARITH_AS(isStringPair, AS_STRING, VAR_C, VAR_D, VAR_B, +, ADDXX)
+#ifndef CYX_COMPUTED_GOTO
             default: UNREACHABLE();
         }
-        pc++;
     }
+#endif
+
+L_HALT:
+    cur_inst = nullptr;
+#ifdef CYX_COMPUTED_GOTO
+    if (end >= 0) threaded_code[end] = end_handler;
+    #undef DISPATCH
+#endif
+#undef CASE
+#undef NEXT
+#undef DISPATCH_TARGET
+#undef BINARY
+#undef COMPARE
+#undef LOAD
+#undef STORE
+#undef BINARY_XX
+#undef BINARY_XI
+#undef CMP_JMP_XX
+#undef CMP_JMP_XI
+#undef REWRITE
+#undef QUICKEN
+#undef DEOPT
+#undef STATE
+#undef SPECIALIZE
+#undef SPECIALIZE_JMP
+#undef ARITH_AS
+#undef COMPARE_AS
+#undef CMP_JMP_AS
+#undef REG_A
+#undef REG_B
+#undef VAR_B
+#undef VAR_C
+#undef VAR_D
+#undef CONST_C
+#undef CONST_D
+#undef AS_INT
+#undef AS_DOUBLE
+#undef AS_STRING
 }
 
-void CVM::VM::setInsts(const std::vector<VMInstruction *> &insts)
+void CVM::VM::setProgram(Program p)
 {
-    vm_insts = insts;
+    program  = std::move(p);
+    buildins = buildinTable().data();
+    site_misses.clear();
+    owner.clear();
+    hotness.clear();
+    versions.clear();
+#ifdef CYX_COMPUTED_GOTO
+    threaded_code.clear();
+#endif
+    first_optimized = program.code.size();
+    growTables(0);
 }
 
-void CVM::VM::setEntry(int i)
+void CVM::VM::setMaxCallDepth(int depth)
 {
-    entry = i;
+    max_call_depth = depth;
 }
 
-void CVM::VM::setEntryEnd(int i)
+void CVM::VM::setFlushPolicy(CYX::FlushPolicy policy)
 {
-    entry_end = i;
+    (output != nullptr ? *output : CYX::output()).setPolicy(policy);
 }
 
-void CVM::VM::setGlobalInitLen(int i)
+void CVM::VM::setOptions(const CompileOptions &o)
 {
-    global_var_init_len = i;
+    options = o;
 }
 
-bool CVM::VM::fetch()
+void CVM::VM::setIO(CYX::Output *out, CYX::Input *in)
 {
-    if (pc == global_var_init_len && mode == Mode::INIT)
-    {
-        pc   = entry;
-        mode = Mode::MAIN;
-        // frame[0] is global var decl table
-        frame.emplace_back();
-    }
-    if (pc == entry_end) return false;
-    if (pc < vm_insts.size())
-    {
-        cur_inst = vm_insts[pc];
-        return true;
-    }
-    return false;
+    output = out;
+    input  = in;
 }
 
-void CVM::VM::unary()
+void CVM::VM::setRecompiler(Recompiler *r)
 {
-    auto *inst   = static_cast<Unary *>(cur_inst);
-    auto &target = reg[inst->reg_idx];
-    if (inst->opcode == Opcode::LNOT)
-        target = !target;
-    else // bnot
-        target = ~target;
+    recompiler = r;
 }
 
-void CVM::VM::binary()
+// the per instruction tables follow the code, [from, end) is new
+void CVM::VM::growTables(int from)
 {
-    auto *inst   = static_cast<Binary *>(cur_inst);
-    int reg_idx1 = inst->reg_idx1;
-    int reg_idx2 = inst->reg_idx2;
-    switch (cur_inst->opcode)
+    site_misses.resize(program.code.size(), 0);
+    owner.resize(program.code.size(), -1);
+    hotness.resize(program.code.size(), 0);
+    int cur = from > 0 ? owner[from - 1] : -1;
+    for (int i = from; i < program.code.size(); i++)
     {
-        case Opcode::ADD: reg[reg_idx1] = reg[reg_idx1] + reg[reg_idx2]; break;
-        case Opcode::SUB: reg[reg_idx1] = reg[reg_idx1] - reg[reg_idx2]; break;
-        case Opcode::MUL: reg[reg_idx1] = reg[reg_idx1] * reg[reg_idx2]; break;
-        case Opcode::DIV: reg[reg_idx1] = reg[reg_idx1] / reg[reg_idx2]; break;
-        case Opcode::MOD: reg[reg_idx1] = reg[reg_idx1] % reg[reg_idx2]; break;
-        case Opcode::EXP: reg[reg_idx1] = std::pow(reg[reg_idx1].as<long long>(), reg[reg_idx2].as<long long>()); break;
-        case Opcode::BAND: reg[reg_idx1] = reg[reg_idx1] & reg[reg_idx2]; break;
-        case Opcode::BOR: reg[reg_idx1] = reg[reg_idx1] | reg[reg_idx2]; break;
-        case Opcode::BXOR: reg[reg_idx1] = reg[reg_idx1] ^ reg[reg_idx2]; break;
-        case Opcode::SHL: reg[reg_idx1] = reg[reg_idx1] << reg[reg_idx2]; break;
-        case Opcode::SHR: reg[reg_idx1] = reg[reg_idx1] >> reg[reg_idx2]; break;
-        case Opcode::LOR: state = reg[reg_idx1] || reg[reg_idx2]; break;
-        case Opcode::LAND: state = reg[reg_idx1] && reg[reg_idx2]; break;
-        case Opcode::NE: state = reg[reg_idx1] != reg[reg_idx2]; break;
-        case Opcode::EQ: state = reg[reg_idx1] == reg[reg_idx2]; break;
-        case Opcode::LT: state = reg[reg_idx1] < reg[reg_idx2]; break;
-        case Opcode::LE: state = reg[reg_idx1] <= reg[reg_idx2]; break;
-        case Opcode::GT: state = reg[reg_idx1] > reg[reg_idx2]; break;
-        case Opcode::GE: state = reg[reg_idx1] >= reg[reg_idx2]; break;
-        default: UNREACHABLE(); break;
+        if (program.code[i].opcode == Opcode::FUNC) cur = i;
+        owner[i] = cur;
     }
+#ifdef CYX_JIT
+    jit.load(program, !options.no_jit);
+#endif
 }
 
-void CVM::VM::loadXA()
+void CVM::VM::heat(int func)
 {
-    auto *inst                      = static_cast<LoadXA *>(cur_inst);
-    reg[inst->reg_idx][inst->index] = *findSymbol(inst->name);
+    if (++hotness[func] == TIER_THRESHOLD && recompiler != nullptr && func < first_optimized)
+        recompiler->request(func, program.names[program.code[func].c]);
 }
 
-void CVM::VM::loadX()
+void CVM::VM::tierUp()
 {
-    auto *inst  = static_cast<LoadX *>(cur_inst);
-    auto target = findSymbol(inst->name);
-    // MAGIC, DO NOT TOUCH...
-    for (auto idx : inst->index)
+    Recompiled version;
+    while (recompiler->poll(version))
     {
-        if (std::holds_alternative<long long>(idx))
-            target = &target->asArray()->at(std::get<long long>(idx));
-        else
+        const int from = program.code.size();
+        versions[version.func] = program.append(version.insts);
+        for (auto *inst : version.insts)
+        {
+            delete inst;
+        }
+        growTables(from);
+        for (auto &inst : program.code)
         {
-            const auto i = findSymbol(std::get<std::string>(idx))->as<long long>();
-            target       = &target->asArray()->at(i);
+            if ((inst.opcode != Opcode::CALL && inst.opcode != Opcode::TAILCALL) || inst.b < 0) continue;
+            if (auto it = versions.find(inst.b); it != versions.end()) inst.b = it->second;
         }
     }
-    reg[inst->reg_idx] = *target;
 }
 
-void CVM::VM::load()
+// push one argument above the current frame, the pushed ones form the argument window of the next CALL
+void CVM::VM::arg()
 {
-    auto op = cur_inst->opcode;
-    if (op == Opcode::LOADI)
-    {
-        auto *inst         = static_cast<LoadI *>(cur_inst);
-        reg[inst->reg_idx] = inst->val;
-    }
-    else if (op == Opcode::LOADD)
-    {
-        auto *inst         = static_cast<LoadD *>(cur_inst);
-        reg[inst->reg_idx] = inst->val;
-    }
-    else if (op == Opcode::LOADS)
+    if (stack_top == stack.size()) growStack(stack.size() * 2);
+    if (cur_inst->a == static_cast<unsigned char>(ArgType::MAP))
+        stack[stack_top] = fetch(frame.back(), cur_inst->b);
+    else
+        stack[stack_top] = program.constants[cur_inst->b];
+    stack_top++;
+}
+
+void CVM::VM::call()
+{
+    if (cur_inst->b < 0)
     {
-        auto *inst         = static_cast<LoadS *>(cur_inst);
-        reg[inst->reg_idx] = inst->val;
+        callBuildin();
+        return;
     }
-    else if (op == Opcode::LOADA)
+    if (recompiler != nullptr && recompiler->ready())
     {
-        auto *inst         = static_cast<LoadA *>(cur_inst);
-        reg[inst->reg_idx] = inst->array;
+        // the code may move, this CALL already goes to the optimized version
+        tierUp();
+        cur_inst = &program.code[pc];
     }
-    else
-        UNREACHABLE();
+    const auto target = cur_inst->b;
+    heat(target);
+    frame.back().pc = pc;
+    // the argument window becomes the param slots of the callee
+    pushFrame(program.code[target].b, program.code[target].d, cur_inst->c);
+#ifdef CYX_JIT
+    // the native callee returns through ret(), which restores pc
+    if (jit.enter(this, target)) return;
+#endif
+    pc = target - 1;
 }
 
-void CVM::VM::storeX()
+// the callee takes over the frame, so a chain of tail calls runs in constant stack
+void CVM::VM::tailCall()
 {
-    auto *inst  = static_cast<StoreX *>(cur_inst);
-    auto target = findSymbol(inst->name);
-    // MAGIC, DO NOT TOUCH...
-    for (auto idx : inst->index)
+    if (recompiler != nullptr && recompiler->ready())
     {
-        if (std::holds_alternative<long long>(idx))
-            target = &target->asArray()->at(std::get<long long>(idx));
-        else
-        {
-            const auto i = findSymbol(std::get<std::string>(idx))->as<long long>();
-            target       = &target->asArray()->at(i);
-        }
+        tierUp();
+        cur_inst = &program.code[pc];
     }
-    *target = reg[inst->reg_idx];
+    const auto target = cur_inst->b;
+    heat(target);
+    replaceFrame(target, cur_inst->c);
+#ifdef CYX_JIT
+    if (jit.enter(this, target)) return;
+#endif
+    pc = target - 1;
 }
 
-void CVM::VM::store()
+// the argument window is moved down to the base of the current frame, which becomes the frame of `target`
+void CVM::VM::replaceFrame(int target, int argc)
 {
-    auto op = cur_inst->opcode;
-    if (op == Opcode::STOREI)
-    {
-        auto *inst                       = static_cast<StoreI *>(cur_inst);
-        frame.back().symbols[inst->name] = inst->val;
-    }
-    else if (op == Opcode::STORED)
+    const int base = frame.back().base;
+    const int args = stack_top - argc;
+    for (int i = 0; i < argc; i++)
     {
-        auto *inst                       = static_cast<StoreD *>(cur_inst);
-        frame.back().symbols[inst->name] = inst->val;
+        stack[base + i] = std::move(stack[args + i]);
     }
-    else if (op == Opcode::STORES)
+    for (int i = base + argc; i < stack_top; i++)
     {
-        auto *inst                       = static_cast<StoreS *>(cur_inst);
-        frame.back().symbols[inst->name] = inst->val;
-    }
-    else if (op == Opcode::STOREA)
-    {
-        auto *inst  = static_cast<StoreA *>(cur_inst);
-        auto target = findSymbol(inst->name);
-        for (auto idx : inst->index)
-        {
-            if (std::holds_alternative<long long>(idx))
-                target = &target->asArray()->at(std::get<long long>(idx));
-            else
-            {
-                const auto i = findSymbol(std::get<std::string>(idx))->as<long long>();
-                target       = &target->asArray()->at(i);
-            }
-        }
-        *target = inst->value;
+        stack[i].reset();
     }
-    else
-        UNREACHABLE();
-}
-
-void CVM::VM::arg()
-{
-    // pass
+    stack_top = base + argc;
+    frame.pop_back();
+    pushFrame(program.code[target].b, program.code[target].d, argc);
 }
 
-void CVM::VM::call()
+void CVM::VM::callBuildin()
 {
-    auto *inst = static_cast<Call *>(cur_inst);
-    if (inst->target < 0)
+    auto *buildin_func = buildins[-cur_inst->b].func;
+    const auto argc    = cur_inst->c;
+    const auto base    = stack_top - argc;
+    // a builtin without result leaves none in %1, never a stale register
+    reg[1].reset();
+    buildin_func(stack.data() + base, argc, reg[1]); // base is one past the end without arguments
+    for (int i = base; i < stack_top; i++)
     {
-        callBuildin();
-        return;
+        stack[i].reset();
     }
-    frame.back().pc = pc;
-    frame.emplace_back(Frame());
-    pc = inst->target - 1;
+    stack_top = base;
 }
 
-void CVM::VM::callBuildin()
+// the result in %1 of the callee is moved into %1 of the caller, nothing else is copied
+void CVM::VM::ret()
 {
-    auto *call         = static_cast<Call *>(cur_inst);
-    auto *buildin_func = buildin_functions_index.at(-call->target);
-    CYX::Value *retval = nullptr;
-    // TODO: some bugs here...
-    if (vm_insts[pc + 1]->opcode == Opcode::ARG)
-    {
-        pc++;
-        auto *arg = static_cast<Arg *>(vm_insts[pc]);
-        if (arg->type == ArgType::MAP)
-        {
-            auto target = findSymbol(arg->name);
-            if (!arg->index.empty())
-            {
-                // MAGIC, DO NOT TOUCH...
-                for (auto idx : arg->index)
-                {
-                    if (std::holds_alternative<long long>(idx))
-                        target = &target->asArray()->at(std::get<long long>(idx));
-                    else
-                    {
-                        const auto i = findSymbol(std::get<std::string>(idx))->as<long long>();
-                        target       = &target->asArray()->at(i);
-                    }
-                }
-            }
-            retval = buildin_func(target);
-        }
-        else if (arg->type == ArgType::RAW)
-        {
-            retval = buildin_func(&arg->value);
-        }
-    }
-    else
-    {
-        retval = buildin_func(nullptr);
-    }
-    if (retval != nullptr) reg[1] = *retval;
+    CYX::Value result = std::move(reg[1]);
+    popFrame();
+    reg[1] = std::move(result);
+    pc     = frame.back().pc;
 }
 
-void CVM::VM::func()
+void CVM::VM::pushFrame(int slot_count, int reg_count, int argc)
 {
-    // pass
+    // global frame is not counted
+    if (frame.size() > max_call_depth) CERR("stack overflow, call depth exceeds " + std::to_string(max_call_depth));
+    const int base = stack_top - argc;
+    stack_top      = base + slot_count + reg_count;
+    frame.emplace_back(base, slot_count, reg_count);
+    if (stack_top > stack.size())
+        growStack(std::max<size_t>(stack_top, stack.size() * 2));
+    else
+        reg = &stack[frame.back().regBase()];
 }
 
-void CVM::VM::param()
+void CVM::VM::popFrame()
 {
-    auto *inst      = static_cast<Param *>(cur_inst);
-    auto *pre_frame = &frame[frame.size() - 2];
-    auto *arg       = static_cast<Arg *>(vm_insts[++pre_frame->pc]);
-    if (arg->type == ArgType::MAP)
-    {
-        if (!arg->index.empty())
-        {
-        }
-        frame.back().symbols[inst->name] = pre_frame->symbols[arg->name];
-    }
-    else if (arg->type == ArgType::RAW)
+    // slots and registers must be empty when they are reused
+    for (int i = frame.back().base; i < stack_top; i++)
     {
-        frame.back().symbols[inst->name] = arg->value;
+        stack[i].reset();
     }
-    else
-        UNREACHABLE();
+    stack_top = frame.back().base;
+    frame.pop_back();
+    reg = frame.empty() ? nullptr : &stack[frame.back().regBase()];
 }
 
-void CVM::VM::ret()
+void CVM::VM::growStack(int size)
 {
-    frame.pop_back();
-    if (frame.size() > 1) pc = frame.back().pc;
+    stack.resize(size);
+    reg = &stack[frame.back().regBase()];
 }
 
-void CVM::VM::jmp()
+CYX::Value &CVM::VM::symbol(Frame &cur_frame, int var)
 {
-    auto *inst = static_cast<Jmp *>(cur_inst);
-    pc         = inst->target - 1;
+    return stack[var >= 0 ? cur_frame.base + var : ~var];
 }
 
-void CVM::VM::jif()
+// for writing, every array on the way is detached from its copies
+CYX::Value *CVM::VM::locate(Frame &cur_frame, int chain_idx)
 {
-    auto *inst = static_cast<Jif *>(cur_inst);
-    if (state)
-        pc = inst->target1 - 1;
-    else
-        pc = inst->target2 - 1;
-    state = false;
+    const auto &chain = program.chains[chain_idx];
+    auto *target      = &symbol(cur_frame, chain.var);
+    for (int i = chain.begin; i < chain.end; i++)
+    {
+        const auto &link = program.links[i];
+        if (link.is_var)
+            target = &target->asArray()->at(symbol(cur_frame, link.value).as<long long>());
+        else
+            target = &target->asArray()->at(link.value);
+    }
+    return target;
 }
 
-CYX::Value *CVM::VM::findSymbol(const std::string &name)
+// for reading, arrays stay shared
+const CYX::Value &CVM::VM::fetch(Frame &cur_frame, int chain_idx)
 {
-    if (frame.back().symbols.find(name) != frame.back().symbols.end()) return &frame.back().symbols[name];
-    if (frame[0].symbols.find(name) == frame[0].symbols.end()) return &frame.back().symbols[name];
-    return &frame[0].symbols[name];
+    const auto &chain        = program.chains[chain_idx];
+    const CYX::Value *target = &symbol(cur_frame, chain.var);
+    for (int i = chain.begin; i < chain.end; i++)
+    {
+        const auto &link = program.links[i];
+        if (link.is_var)
+            target = &target->asArray()->at(symbol(cur_frame, link.value).as<long long>());
+        else
+            target = &target->asArray()->at(link.value);
+    }
+    return *target;
 }
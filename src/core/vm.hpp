@@ -2,72 +2,101 @@
 #define CORE_VM_HPP
 
 #include "../common/buildin.hpp"
+#include "../common/config.h"
 #include "../common/value.hpp"
 #include "frame.hpp"
+#include "jit.h"
 #include "opcode.hpp"
-#include "vm_instruction.hpp"
+#include "program.h"
+#include "tier.h"
 
-#include <array>
+#include <algorithm>
 #include <cmath>
 #include <dbg.h>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+// labels as values is a GNU extension, other compilers always use the switch loop.
+#if defined(CYX_DIRECT_THREADED) && (defined(__GNUC__) || defined(__clang__))
+    #define CYX_COMPUTED_GOTO
+#endif
+
 namespace CVM
 {
     class VM
     {
+#ifdef CYX_JIT
+        friend class JIT;
+#endif
+
       public:
         void run();
 
       private:
-        bool fetch();
-        void unary();
-        void binary();
-        //
-        void loadX();
-        void loadXA();
-        void load();
-        //
-        void storeX();
-        void store();
+        // run [begin, end), instruction at `end` is not executed.
+        // a negative `end` runs till the frame of `begin` returns
+        void execute(int begin, int end);
         //
         void arg();
         void call();
+        void tailCall();
         void callBuildin();
-        void func();
-        void param();
         void ret();
-        void jmp();
-        void jif();
+        void pushFrame(int slot_count, int reg_count, int argc = 0);
+        void popFrame();
+        void replaceFrame(int target, int argc);
+        void growStack(int size);
+        // a call or loop iteration of the function at FUNC position `func`
+        void heat(int func);
+        // link the versions the Recompiler finished, calls to the old ones go to them from now on
+        void tierUp();
+        void growTables(int from);
         //
-        CYX::Value *findSymbol(const std::string &name);
+        CYX::Value &symbol(Frame &cur_frame, int var);
+        CYX::Value *locate(Frame &cur_frame, int chain_idx);
+        const CYX::Value &fetch(Frame &cur_frame, int chain_idx);
 
       private:
-        enum class Mode
-        {
-            INIT,
-            MAIN
-        };
-        std::array<CYX::Value, 12> reg;
-        std::vector<CVM::Frame> frame{ Frame() };
+        CYX::Value *reg{ nullptr };    // register window of the current frame, %0 is the if stmt state
+        std::vector<CVM::Frame> frame; // frame[0] is global var decl table
+        std::vector<CYX::Value> stack; // slots and registers of every frame
+        int stack_top{ 0 };            // first unused slot
+        int max_call_depth{ DEFAULT_MAX_CALL_DEPTH };
         //
-        CYX::Value &state = reg[0]; // if stmt state
-        std::vector<VMInstruction *> vm_insts;
-        VMInstruction *cur_inst{ nullptr };
+        Program program;
+        const Instruction *cur_inst{ nullptr };
+        const Buildin *buildins{ nullptr }; // taken by setProgram, the table is frozen from then on
+        CompileOptions options;
+        CYX::Output *output{ nullptr };
+        CYX::Input *input{ nullptr };
+#ifdef CYX_COMPUTED_GOTO
+        std::vector<const void *> threaded_code; // handler address of each instruction
+#endif
+        std::vector<unsigned char> site_misses; // deoptimizations of each instruction, see MAX_QUICKEN_MISSES
+        // profile: FUNC position of the function of each instruction(-1 for global code),
+        // calls and loop iterations of the function at each FUNC position
+        std::vector<int> owner;
+        std::vector<long long> hotness;
+        // tiering
+        Recompiler *recompiler{ nullptr };
+        int first_optimized{ 0 };              // functions from here on are optimized versions
+        std::unordered_map<int, int> versions; // FUNC position -> FUNC position of its optimized version
+#ifdef CYX_JIT
+        JIT jit;
+#endif
         //
-        Mode mode = Mode::INIT;
-        int entry{ 0 };               // main function position
-        int entry_end{ 0 };           // main function end
-        int pc{ 0 };                  // program counter
-        int global_var_init_len{ 0 }; // global data initialize instruction length
+        int pc{ 0 }; // program counter
 
       public:
-        void setInsts(const std::vector<VMInstruction *> &insts);
-        void setEntry(int i);
-        void setGlobalInitLen(int i);
-        void setEntryEnd(int i);
+        void setProgram(Program p);
+        void setMaxCallDepth(int depth);
+        void setFlushPolicy(CYX::FlushPolicy policy);
+        void setOptions(const CompileOptions &o); // before setProgram
+        // print/read of the program go to them instead of the process stdout/stdin, nullptr keeps those
+        void setIO(CYX::Output *out, CYX::Input *in);
+        void setRecompiler(Recompiler *r);
     };
 } // namespace CVM
 
@@ -7,6 +7,9 @@
 #include <memory>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <variant>
+#include <vector>
 
 namespace CVM
 {
@@ -24,8 +27,35 @@ namespace CVM
         virtual std::string toString() = 0;
     };
 
+    // variable operand, `slot` is resolved by BytecodeGenerator::relocation()
+    struct VarRef
+    {
+        VarRef() = default;
+        explicit VarRef(std::string name) : name(std::move(name))
+        {
+        }
+        std::string name;
+        int slot{ -1 };       // index into Frame::slots
+        bool global{ false }; // slot of the global frame
+    };
+
     // for LOADX. STOREX
-    using ArrIdx = std::variant<std::string, long long>;
+    using ArrIdx = std::variant<VarRef, long long>;
+
+    static inline std::string arrIdxStr(const std::vector<ArrIdx> &index)
+    {
+        std::string str;
+        for (const auto &idx : index)
+        {
+            str += "[";
+            if (std::holds_alternative<long long>(idx))
+                str += std::to_string(std::get<long long>(idx));
+            else
+                str += std::get<VarRef>(idx).name;
+            str += "]";
+        }
+        return str;
+    }
 
     struct Load : VMInstruction
     {
@@ -58,19 +88,9 @@ namespace CVM
         }
         std::string toString() override
         {
-            std::string str = "LOADX %" + std::to_string(reg_idx) + " " + name;
-            for (int i = 0; i < index.size(); i++)
-            {
-                str += "[";
-                if (std::holds_alternative<long long>(index[i]))
-                    str += std::to_string(std::get<long long>(index[i]));
-                else
-                    str += std::get<std::string>(index[i]);
-                str += "]";
-            }
-            return str;
+            return "LOADX %" + std::to_string(reg_idx) + " " + var.name + arrIdxStr(index);
         }
-        std::string name;
+        VarRef var;
         std::vector<ArrIdx> index;
     };
 
@@ -82,9 +102,9 @@ namespace CVM
         }
         std::string toString() override
         {
-            return "LOADXA %" + std::to_string(reg_idx) + "," + std::to_string(index) + " " + name;
+            return "LOADXA %" + std::to_string(reg_idx) + "," + std::to_string(index) + " " + var.name;
         }
-        std::string name;
+        VarRef var;
         int index;
     };
 
@@ -113,7 +133,7 @@ namespace CVM
 
     struct Store : VMInstruction
     {
-        std::string name;
+        VarRef var;
     };
 
     struct StoreA : Store
@@ -125,17 +145,7 @@ namespace CVM
         std::vector<CVM::ArrIdx> index;
         std::string toString() override
         {
-            std::string str = "STOREA " + name;
-            for (int i = 0; i < index.size(); i++)
-            {
-                str += "[";
-                if (std::holds_alternative<long long>(index[i]))
-                    str += std::to_string(std::get<long long>(index[i]));
-                else
-                    str += std::get<std::string>(index[i]);
-                str += "] " + value.as<std::string>();
-            }
-            return str;
+            return "STOREA " + var.name + arrIdxStr(index) + " " + value.as<std::string>();
         }
         CYX::Value value;
     };
@@ -148,17 +158,7 @@ namespace CVM
         }
         std::string toString() override
         {
-            std::string str = "STOREX " + name;
-            for (int i = 0; i < index.size(); i++)
-            {
-                str += "[";
-                if (std::holds_alternative<long long>(index[i]))
-                    str += std::to_string(std::get<long long>(index[i]));
-                else
-                    str += std::get<std::string>(index[i]);
-                str += "]";
-            }
-            return str + " %" + std::to_string(reg_idx);
+            return "STOREX " + var.name + arrIdxStr(index) + " %" + std::to_string(reg_idx);
         }
         int reg_idx{ -1 };
         std::vector<ArrIdx> index;
@@ -174,7 +174,7 @@ namespace CVM
         std::string toString() override                                                                                \
         {                                                                                                              \
             std::ostringstream oss;                                                                                    \
-            oss << #OP << " " << name;                                                                                 \
+            oss << #OP << " " << var.name;                                                                                 \
             oss << " " << val;                                                                                         \
             return oss.str();                                                                                          \
         }                                                                                                              \
@@ -194,25 +194,16 @@ namespace CVM
             opcode = Opcode::ARG;
         }
         ArgType type{ ArgType::RAW };
-        std::string name;
+        VarRef var;
         CYX::Value value;
         std::vector<ArrIdx> index;
         std::string toString() override
         {
-            std::string str = type == ArgType::RAW ? "RAW " + value.as<std::string>() : "MAP " + name;
-            for (int i = 0; i < index.size(); i++)
-            {
-                str += "[";
-                if (std::holds_alternative<long long>(index[i]))
-                    str += std::to_string(std::get<long long>(index[i]));
-                else
-                    str += std::get<std::string>(index[i]);
-                str += "]";
-            }
-            return str;
+            return type == ArgType::RAW ? "RAW " + value.as<std::string>() : "MAP " + var.name + arrIdxStr(index);
         }
     };
 
+    // arguments are pushed by the `argc` ARG instructions right before CALL
     struct Call : VMInstruction
     {
         Call()
@@ -221,16 +212,12 @@ namespace CVM
         }
         std::string toString() override
         {
-            std::string retval = "CALL " + name + "(" + std::to_string(target) + ")";
-            for (auto arg : args)
-            {
-                retval += "\n" + arg.toString();
-            }
-            return retval;
+            return std::string(opcode == Opcode::TAILCALL ? "TAILCALL " : "CALL ") + name + "(" + std::to_string(target) +
+                   ") ARGC " + std::to_string(argc);
         };
         std::string name;
         int target{ -1 };
-        std::vector<Arg> args;
+        int argc{ 0 };
     };
 
     struct Func : VMInstruction
@@ -241,24 +228,15 @@ namespace CVM
         }
         std::string toString() override
         {
-            return "FUNC " + name + " PARAM COUNT " + std::to_string(param_count);
+            return "FUNC " + name + " PARAM COUNT " + std::to_string(param_count) + " SLOT COUNT " +
+                   std::to_string(slot_count) + " REGISTER COUNT " + std::to_string(reg_count);
         }
 
         std::string name;
         int param_count{ 0 };
-    };
-
-    struct Param : VMInstruction
-    {
-        Param()
-        {
-            opcode = Opcode::PARAM;
-        }
-        std::string toString() override
-        {
-            return "PARAM " + name;
-        }
-        std::string name;
+        int slot_count{ 0 };             // params come first, filled by BytecodeGenerator::relocation()
+        int reg_count{ 0 };              // registers of the frame, filled by BytecodeGenerator::relocation()
+        std::vector<std::string> params; // compiler only, not in bytecode
     };
 
     struct Ret : VMInstruction
@@ -380,7 +358,7 @@ namespace CVM
         int reg_idx{ -2 };
         ArgType type;
         CYX::Value value;
-        std::string name;
+        VarRef var;
     };
 
 #define UNARY_INST(X, OP)                                                                                              \
@@ -401,6 +379,77 @@ namespace CVM
 
 #undef UNARY_INST
 
+    // superinstructions, fused from the LOADX/LOADI/op/STOREX and op/JIF sequences by SuperInstruction
+
+    // <op>XX dst = src1 op src2
+    // <op>XI dst = src1 op imm
+    struct ArithmeticX : VMInstruction
+    {
+        explicit ArithmeticX(Opcode op)
+        {
+            opcode = op;
+        }
+        bool isImm() const
+        {
+            return opcode >= Opcode::ADDXI;
+        }
+        std::string toString() override
+        {
+            static const char *const names[] = { "ADD", "SUB", "MUL", "DIV", "MOD" };
+            const auto first = isImm() ? Opcode::ADDXI : Opcode::ADDXX;
+            std::string str  = names[opcode2UChar(opcode) - opcode2UChar(first)];
+            str += (isImm() ? "XI " : "XX ") + dst.name + " " + src1.name + " ";
+            return str + (isImm() ? imm.as<std::string>() : src2.name);
+        }
+        VarRef dst;
+        VarRef src1;
+        VarRef src2;    // XX only
+        CYX::Value imm; // XI only, int or double
+    };
+
+    // J<cmp>XX src1 cmp src2
+    // J<cmp>XI src1 cmp imm
+    // falls through if the comparison holds, otherwise jumps to `basic_block_name`
+    struct CmpJmp : VMInstruction
+    {
+        explicit CmpJmp(Opcode op)
+        {
+            opcode = op;
+        }
+        bool isImm() const
+        {
+            return opcode >= Opcode::JNEXI;
+        }
+        std::string toString() override
+        {
+            static const char *const names[] = { "NE", "EQ", "LT", "LE", "GT", "GE" };
+            const auto first = isImm() ? Opcode::JNEXI : Opcode::JNEXX;
+            std::string str  = std::string("J") + names[opcode2UChar(opcode) - opcode2UChar(first)];
+            str += (isImm() ? "XI " : "XX ") + src1.name + " " + (isImm() ? imm.as<std::string>() : src2.name);
+            return str + " " + std::to_string(target);
+        }
+        VarRef src1;
+        VarRef src2;
+        CYX::Value imm;
+        std::string basic_block_name;
+        int target{ -1 };
+    };
+
+    // dst = src
+    struct MovX : VMInstruction
+    {
+        MovX()
+        {
+            opcode = Opcode::MOVX;
+        }
+        std::string toString() override
+        {
+            return "MOVX " + dst.name + " " + src.name;
+        }
+        VarRef dst;
+        VarRef src;
+    };
+
 } // namespace CVM
 
 #endif // CVM_VM_INSTRUCTION_HPP
@@ -3,10 +3,12 @@
 #include "compiler/bytecode/bytecode_generator.h"
 #include "compiler/bytecode/bytecode_writer.h"
 #include "compiler/bytecode/peephole_optimization.h"
+#include "compiler/bytecode/superinstruction.h"
 #include "compiler/ir/basicblock.hpp"
 #include "compiler/ir/cfg.h"
 #include "compiler/ir/ir_generator.h"
 #include "compiler/parser.h"
+#include "compiler/tiered_compiler.h"
 #include "compiler/token.hpp"
 #include "core/bytecode_reader.h"
 #include "core/vm.hpp"
@@ -23,13 +25,23 @@ void showHelp()
     str += "cyx2 -i-bytecode <bytecode file>\n";
     const std::vector<std::vector<std::string>> usage = {
         { "-ssa", "enable SSA mode, default is disabled" },                                               //
-        { "-constant-folding", "enable constant folding(SSA based)" },                                    //
+        { "-ssa-form", "<pruned|semi-pruned|minimal> where phis are placed, pruned by default" },         //
+        { "-constant-folding", "enable constant folding and pruning constant branches(SSA based)" },      //
         { "-constant-propagation", "enable constant propagation(constant folding and SSA based)" },       //
+        { "-global-value-numbering", "reuse expressions and array reads computed before(SSA based)" },    //
         { "-no-code-simplify", "disable clearing temporary variables(after normal ir construction)" },    //
         { "-no-cfg-simplify", "disable clearing redundant basicblocks(empty and useless basicblocks)" },  //
         { "-remove-unused-code", "remove unused variable definitions, base on normal IR(aggressively)" }, //
         { "-dead-code-elimination", "dead code elimination(SSA based)" },                                 //
         { "-peephole", "enable peephole optimization(base on bytecode)" },                                //
+        { "-no-superinstruction", "disable fusing instructions into superinstructions(after peephole)" }, //
+        { "-no-register-allocation", "disable sharing frame slots between variables, keep dead stores" }, //
+        { "-no-jit", "disable compiling hot functions to x86-64 machine code(Linux x86-64 only)" },        //
+        { "-tiered", "run unoptimized first, hot functions get SSA and peephole options in background" },  //
+        { "-no-tail-call", "disable reusing the frame for a call whose result is returned right away" },   //
+        { "-compile-threads", "<count> functions transformed to SSA in parallel, one per core(default)" },   //
+        { "-max-call-depth", "<depth> max function call depth, stack overflow beyond it(65536)" },        //
+        { "-flush", "<line|block|exit> when the program output is written, block by default" },           //
         { "-dump-cfg", "dump CFG(Graphviz), dump to stdout if `-dump-as-file` is not set" },              //
         { "-dump-ir", "dump IR, dump to stdout if `-dump-as-file` is not set" },                          //
         { "-dump-ast", "dump AST(Graphviz), dump to stdout if `-dump-as-file` is not set" },              //
@@ -59,12 +71,13 @@ void readBytecode(CVM::BytecodeReader &bytecode_reader)
     bytecode_reader.readInsts();
 }
 
-void runVM(CVM::VM &vm, const std::vector<CVM::VMInstruction *> &insts, int entry, int entry_end, int global_init_len)
+void runVM(CVM::VM &vm, const CVM::Program &program, const CompileOptions &options, int max_call_depth,
+           CYX::FlushPolicy flush_policy)
 {
-    vm.setInsts(insts);
-    vm.setEntry(entry);
-    vm.setEntryEnd(entry_end);
-    vm.setGlobalInitLen(global_init_len);
+    vm.setOptions(options);
+    vm.setProgram(program);
+    vm.setMaxCallDepth(max_call_depth);
+    vm.setFlushPolicy(flush_policy);
     vm.run();
 }
 
@@ -84,6 +97,8 @@ int main(int argc, char *argv[])
         showHelp();
         return 0;
     }
+    // nothing is written through C stdio
+    std::ios::sync_with_stdio(false);
     std::vector<std::string> args(argv + 1, argv + argc);
     std::string ast_output     = "cyx.ast";  // text
     std::string vm_inst_output = "cyx.inst"; // text
@@ -93,24 +108,37 @@ int main(int argc, char *argv[])
     std::string bytecode_input;              // binary
     std::string src_input = args.back();
     //
-    bool dump_as_file = false;
+    CompileOptions options;
+    bool dump_ast      = false;
+    bool dump_ir       = false;
+    bool dump_cfg      = false;
+    bool dump_vm_inst  = false;
+    bool dump_as_file  = false;
+    int max_call_depth = DEFAULT_MAX_CALL_DEPTH;
+    auto flush_policy  = CYX::FlushPolicy::BLOCK;
     //
 
 #define CASE_TRUE(COND, VAR) else if (args[i] == (COND)) VAR = true;
     for (int i = 0; i < args.size() - 1; i++)
     {
-        if (args[i] == "-ssa") NO_SSA = false;
-        CASE_TRUE("-constant-folding", CONSTANT_FOLDING)
-        CASE_TRUE("-constant-propagation", CONSTANT_PROPAGATION)
-        CASE_TRUE("-no-code-simplify", NO_CODE_SIMPLIFY)
-        CASE_TRUE("-no-cfg-simplify", NO_CFG_SIMPLIFY)
-        CASE_TRUE("-remove-unused-code", REMOVE_UNUSED_DEFINE)
-        CASE_TRUE("-dead-code-elimination", DEAD_CODE_ELIMINATION)
-        CASE_TRUE("-peephole", PEEPHOLE)
-        CASE_TRUE("-dump-cfg", DUMP_CFG_STR)
-        CASE_TRUE("-dump-ir", DUMP_IR_STR)
-        CASE_TRUE("-dump-ast", DUMP_AST_STR)
-        CASE_TRUE("-dump-vm-inst", DUMP_VM_INST_STR)
+        if (args[i] == "-ssa") options.no_ssa = false;
+        CASE_TRUE("-constant-folding", options.constant_folding)
+        CASE_TRUE("-constant-propagation", options.constant_propagation)
+        CASE_TRUE("-global-value-numbering", options.global_value_numbering)
+        CASE_TRUE("-no-code-simplify", options.no_code_simplify)
+        CASE_TRUE("-no-cfg-simplify", options.no_cfg_simplify)
+        CASE_TRUE("-remove-unused-code", options.remove_unused_define)
+        CASE_TRUE("-dead-code-elimination", options.dead_code_elimination)
+        CASE_TRUE("-peephole", options.peephole)
+        CASE_TRUE("-no-superinstruction", options.no_superinstruction)
+        CASE_TRUE("-no-register-allocation", options.no_register_allocation)
+        CASE_TRUE("-no-jit", options.no_jit)
+        CASE_TRUE("-tiered", options.tiered)
+        CASE_TRUE("-no-tail-call", options.no_tail_call)
+        CASE_TRUE("-dump-cfg", dump_cfg)
+        CASE_TRUE("-dump-ir", dump_ir)
+        CASE_TRUE("-dump-ast", dump_ast)
+        CASE_TRUE("-dump-vm-inst", dump_vm_inst)
         CASE_TRUE("-dump-as-file", dump_as_file)
         else if (args[i] == "-o-ast")
         {
@@ -136,6 +164,46 @@ int main(int argc, char *argv[])
         {
             vm_inst_output = args[++i];
         }
+        else if (args[i] == "-ssa-form")
+        {
+            const auto &form = args[++i];
+            if (form == "pruned")
+                options.ssa_form = SSAForm::PRUNED;
+            else if (form == "semi-pruned")
+                options.ssa_form = SSAForm::SEMI_PRUNED;
+            else if (form == "minimal")
+                options.ssa_form = SSAForm::MINIMAL;
+            else
+            {
+                std::cerr << "Unsupported SSA form `" + form + "` \n";
+                showHelp();
+                return 0;
+            }
+        }
+        else if (args[i] == "-compile-threads")
+        {
+            options.compile_threads = std::stoi(args[++i]);
+        }
+        else if (args[i] == "-max-call-depth")
+        {
+            max_call_depth = std::stoi(args[++i]);
+        }
+        else if (args[i] == "-flush")
+        {
+            const auto &policy = args[++i];
+            if (policy == "line")
+                flush_policy = CYX::FlushPolicy::LINE;
+            else if (policy == "block")
+                flush_policy = CYX::FlushPolicy::BLOCK;
+            else if (policy == "exit")
+                flush_policy = CYX::FlushPolicy::EXIT;
+            else
+            {
+                std::cerr << "Unsupported flush policy `" + policy + "` \n";
+                showHelp();
+                return 0;
+            }
+        }
         else
         {
             std::cerr << "Unsupported option `" + args[i] + "` \n";
@@ -152,48 +220,63 @@ int main(int argc, char *argv[])
         CVM::BytecodeReader bytecode_reader(bytecode_input);
         CVM::VM vm;
         readBytecode(bytecode_reader);
-        runVM(vm, bytecode_reader.vm_insts, bytecode_reader.entry, bytecode_reader.entry_end,
-              bytecode_reader.global_var_len);
+        runVM(vm, bytecode_reader.program, options, max_call_depth, flush_policy);
         return 0;
     }
 
     // read src
     std::ifstream in(src_input, std::ios::in);
     std::string code((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    // the first tier is compiled quickly, the hot functions get `options` in the background
+    const bool tiered = options.tiered && bytecode_output.empty();
+    auto first_tier   = options;
+    if (tiered)
+    {
+        first_tier.no_ssa   = true;
+        first_tier.peephole = false;
+    }
     // parse src
     COMPILER::Parser parser(code);
     auto *ast = parser.parse();
     // build ir
-    COMPILER::IRGenerator ir_generator;
+    COMPILER::IRGenerator ir_generator(first_tier);
     ir_generator.visitTree(ast);
 
     // NO_CODE_SIMPLIFY is moved to the end of IRGenerator::visitTree()
 
-    if (REMOVE_UNUSED_DEFINE) 
+    if (first_tier.remove_unused_define) 
       ir_generator.removeUnusedVarDef();
     // cfg, ssa, optimize related.
-    COMPILER::CFG cfg;
+    COMPILER::CFG cfg(first_tier);
     cfg.funcs = ir_generator.funcs;
-    if (!NO_CFG_SIMPLIFY) 
+    if (!first_tier.no_cfg_simplify) 
       cfg.simplifyCFG();
-    if (!NO_SSA) 
+    if (!first_tier.no_ssa) 
       cfg.transformToSSA();
+    if (!first_tier.no_tail_call)
+        cfg.markTailCalls();
     // vm instruction builder
-    COMPILER::BytecodeGenerator bytecode_generator;
+    COMPILER::BytecodeGenerator bytecode_generator(first_tier);
     bytecode_generator.funcs       = cfg.funcs;
     bytecode_generator.global_vars = ir_generator.global_var_decl;
     bytecode_generator.ir2VmInst();
     // peephole
-    if (PEEPHOLE)
+    if (first_tier.peephole)
     {
         COMPILER::PeepholeOptimization peephole;
         peephole.block_list = &bytecode_generator.bytecode_basicblocks;
         peephole.doPeepholeOptimization();
+        if (!first_tier.no_superinstruction)
+        {
+            COMPILER::SuperInstruction superinstruction;
+            superinstruction.block_list = &bytecode_generator.bytecode_basicblocks;
+            superinstruction.doSuperInstruction();
+        }
     }
     bytecode_generator.relocation();
 
     // dump debug str
-    if (DUMP_AST_STR)
+    if (dump_ast)
     {
         COMPILER::ASTVisualize ast_visualizer;
         ast_visualizer.visitTree(ast);
@@ -202,21 +285,21 @@ int main(int argc, char *argv[])
         else
             writeFile(ast_output, ast_visualizer.astStr());
     }
-    if (DUMP_IR_STR)
+    if (dump_ir)
     {
         if (!dump_as_file)
             std::cout << ir_generator.irStr();
         else
             writeFile(ir_output, ir_generator.irStr());
     }
-    if (DUMP_CFG_STR)
+    if (dump_cfg)
     {
         if (!dump_as_file)
             std::cout << cfg.cfgStr();
         else
             writeFile(cfg_output, cfg.cfgStr());
     }
-    if (DUMP_VM_INST_STR)
+    if (dump_vm_inst)
     {
         if (!dump_as_file)
             std::cout << bytecode_generator.vmInstStr();
@@ -227,17 +310,25 @@ int main(int argc, char *argv[])
     if (!bytecode_output.empty())
     {
         COMPILER::BytecodeWriter bytecode_writer(bytecode_output);
-        bytecode_writer.entry          = bytecode_generator.entry;
-        bytecode_writer.entry_end      = bytecode_generator.entry_end;
-        bytecode_writer.global_var_len = bytecode_generator.global_var_len;
-        bytecode_writer.vm_insts       = bytecode_generator.vm_insts;
+        bytecode_writer.entry             = bytecode_generator.entry;
+        bytecode_writer.entry_end         = bytecode_generator.entry_end;
+        bytecode_writer.global_var_len    = bytecode_generator.global_var_len;
+        bytecode_writer.global_slot_count = bytecode_generator.global_slot_count;
+        bytecode_writer.global_reg_count  = bytecode_generator.global_reg_count;
+        bytecode_writer.vm_insts          = bytecode_generator.vm_insts;
         bytecode_writer.writeInsts();
         bytecode_writer.writeToFile();
         return 0;
     }
 
     CVM::VM vm;
-    runVM(vm, bytecode_generator.vm_insts, bytecode_generator.entry, bytecode_generator.entry_end,
-          bytecode_generator.global_var_len);
+    if (!tiered)
+    {
+        runVM(vm, bytecode_generator.program, options, max_call_depth, flush_policy);
+        return 0;
+    }
+    COMPILER::TieredCompiler tiered_compiler(code, bytecode_generator.program, options);
+    vm.setRecompiler(&tiered_compiler);
+    runVM(vm, bytecode_generator.program, options, max_call_depth, flush_policy);
     return 0;
 }
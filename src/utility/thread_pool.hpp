@@ -0,0 +1,104 @@
+#ifndef CVM_THREAD_POOL_HPP
+#define CVM_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed workers for data parallel jobs, `run` hands out the indices of one job and returns once all of them are done.
+// the calling thread works on the job too, a pool of one thread runs everything inline.
+class ThreadPool
+{
+  public:
+    // `threads` counts the calling thread
+    explicit ThreadPool(int threads)
+    {
+        for (int i = 1; i < threads; i++)
+        {
+            workers.emplace_back([this]() { work(); });
+        }
+    }
+    ThreadPool(const ThreadPool &)            = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        wake.notify_all();
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+    }
+    // f(0) ... f(count - 1) in any order and on any thread
+    void run(size_t count, const std::function<void(size_t)> &f)
+    {
+        if (workers.empty() || count <= 1)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                f(i);
+            }
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job       = &f;
+            job_count = count;
+            next      = 0;
+            generation++;
+        }
+        wake.notify_all();
+        drain(f, count);
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this]() { return busy == 0; });
+        job = nullptr; // a worker waking up late finds nothing to do
+    }
+
+  private:
+    void work()
+    {
+        size_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            wake.wait(lock, [&]() { return stop || generation != seen; });
+            if (stop) return;
+            seen = generation;
+            if (job == nullptr) continue;
+            const auto *f      = job;
+            const size_t count = job_count;
+            busy++;
+            lock.unlock();
+            drain(*f, count);
+            lock.lock();
+            if (--busy == 0) idle.notify_one();
+        }
+    }
+    void drain(const std::function<void(size_t)> &f, size_t count)
+    {
+        for (size_t i = next++; i < count; i = next++)
+        {
+            f(i);
+        }
+    }
+
+  private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    const std::function<void(size_t)> *job{ nullptr };
+    size_t job_count{ 0 };
+    size_t generation{ 0 };
+    int busy{ 0 }; // workers inside the current job
+    std::atomic<size_t> next{ 0 };
+    bool stop{ false };
+};
+
+#endif // CVM_THREAD_POOL_HPP
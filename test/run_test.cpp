@@ -35,14 +35,15 @@ class CYXTest
         return res;
     }
 
-    std::string executeBytecode(const std::string &path)
+    std::string executeBytecode(const std::string &path, const std::string &options = "")
     {
         const std::string raw_path      = "/" + path;
         const std::string src_file      = testcase_dir + raw_path + ".cyx";
         const std::string input_file    = test_in_dir + raw_path + ".txt";
         const std::string bytecode_file = test_tmp_dir + raw_path;
         std::string res;
-        const std::string build_cmd = executable_file + " -o-bytecode " + bytecode_file + " " + src_file;
+        const std::string build_cmd =
+            executable_file + " " + options + " -o-bytecode " + bytecode_file + " " + src_file;
         system(build_cmd.c_str());
         const std::string command = executable_file + " -i-bytecode " + bytecode_file +
                                     (fs::is_regular_file(input_file) ? " < " + input_file : "");
@@ -125,6 +126,114 @@ TEST(Basic, array)
     EXPECT_EQ(test.executeBytecode(file), test.readfile(file));
 }
 
+TEST(Basic, array_copy)
+{
+    CYXTest test;
+    const std::string file = "basic/array_copy";
+    EXPECT_EQ(test.execute(file, ""), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-remove-unused-code"), test.readfile(file));
+    EXPECT_EQ(test.executeBytecode(file), test.readfile(file));
+}
+
+TEST(Basic, superinstruction)
+{
+    CYXTest test;
+    const std::string file = "basic/superinstruction";
+    EXPECT_EQ(test.execute(file, ""), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-no-superinstruction"), test.readfile(file));
+    EXPECT_EQ(test.executeBytecode(file, "-peephole"), test.readfile(file));
+}
+
+TEST(Basic, quicken)
+{
+    CYXTest test;
+    const std::string file = "basic/quicken";
+    EXPECT_EQ(test.execute(file, ""), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-peephole"), test.readfile(file));
+    EXPECT_EQ(test.executeBytecode(file, "-peephole"), test.readfile(file));
+}
+
+TEST(Basic, register_allocation)
+{
+    CYXTest test;
+    const std::string file = "basic/register_allocation";
+    EXPECT_EQ(test.execute(file, ""), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-peephole"), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-no-register-allocation"), test.readfile(file));
+    EXPECT_EQ(test.executeBytecode(file, "-peephole"), test.readfile(file));
+}
+
+TEST(Basic, jit)
+{
+    CYXTest test;
+    const std::string file = "basic/jit";
+    EXPECT_EQ(test.execute(file, ""), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-no-jit"), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-peephole"), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-peephole -no-jit"), test.readfile(file));
+    EXPECT_EQ(test.executeBytecode(file, "-peephole"), test.readfile(file));
+}
+
+TEST(Basic, osr)
+{
+    CYXTest test;
+    const std::string file = "basic/osr";
+    EXPECT_EQ(test.execute(file, ""), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-no-jit"), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-peephole"), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-peephole -no-jit"), test.readfile(file));
+}
+
+TEST(Basic, tiered)
+{
+    CYXTest test;
+    const std::string file = "basic/tiered";
+    EXPECT_EQ(test.execute(file, "-tiered"), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-tiered -peephole"), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-tiered -peephole -no-jit"), test.readfile(file));
+    EXPECT_EQ(test.executeBytecode(file, "-tiered -peephole"), test.readfile(file));
+}
+
+TEST(Basic, tail_call)
+{
+    CYXTest test;
+    const std::string file = "basic/tail_call";
+    EXPECT_EQ(test.execute(file, ""), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-no-jit"), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-peephole"), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-peephole -no-jit"), test.readfile(file));
+    EXPECT_EQ(test.executeBytecode(file, "-peephole"), test.readfile(file));
+}
+
+TEST(Basic, output)
+{
+    CYXTest test;
+    const std::string file = "basic/output";
+    EXPECT_EQ(test.execute(file, ""), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-flush line"), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-flush exit"), test.readfile(file));
+    EXPECT_EQ(test.executeBytecode(file), test.readfile(file));
+}
+
+TEST(Basic, input)
+{
+    CYXTest test;
+    const std::string file = "basic/input";
+    EXPECT_EQ(test.execute(file, ""), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-peephole"), test.readfile(file));
+    EXPECT_EQ(test.executeBytecode(file), test.readfile(file));
+}
+
+TEST(Basic, power)
+{
+    CYXTest test;
+    const std::string file = "basic/power";
+    EXPECT_EQ(test.execute(file, ""), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-peephole"), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-no-jit"), test.readfile(file));
+    EXPECT_EQ(test.executeBytecode(file), test.readfile(file));
+}
+
 TEST(Basic, num_calc)
 {
     CYXTest test;
@@ -262,6 +371,23 @@ TEST(Overall, buildin)
     EXPECT_EQ(test.executeBytecode(file), test.readfile(file));
 }
 
+TEST(Overall, stack_overflow)
+{
+    CYXTest test;
+    const std::string file = "overall/stack_overflow";
+    EXPECT_EQ(test.execute(file, "-max-call-depth 3000"), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-max-call-depth 3000 -remove-unused-code"), test.readfile(file));
+}
+
+TEST(Overall, call_args)
+{
+    CYXTest test;
+    const std::string file = "overall/call_args";
+    EXPECT_EQ(test.execute(file, ""), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-remove-unused-code"), test.readfile(file));
+    EXPECT_EQ(test.executeBytecode(file), test.readfile(file));
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 TEST(SSA, daffodil_number)
@@ -300,6 +426,49 @@ TEST(SSA, constant_folding2)
     EXPECT_EQ(test.executeBytecode(file), test.readfile(file));
 }
 
+TEST(SSA, pruned)
+{
+    CYXTest test;
+    const std::string file = "ssa/pruned";
+    EXPECT_EQ(test.execute(file, "-ssa"), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-ssa -ssa-form semi-pruned"), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-ssa -ssa-form minimal"), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-ssa -constant-folding -constant-propagation -dead-code-elimination"),
+              test.readfile(file));
+    EXPECT_EQ(test.executeBytecode(file), test.readfile(file));
+}
+
+TEST(SSA, sccp)
+{
+    CYXTest test;
+    const std::string file = "ssa/sccp";
+    EXPECT_EQ(test.execute(file, "-ssa -constant-folding"), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-ssa -constant-folding -constant-propagation -dead-code-elimination"),
+              test.readfile(file));
+    EXPECT_EQ(test.executeBytecode(file), test.readfile(file));
+}
+
+TEST(SSA, sccp_global)
+{
+    CYXTest test;
+    const std::string file = "ssa/sccp_global";
+    EXPECT_EQ(test.execute(file, "-ssa -constant-folding"), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-ssa -constant-folding -constant-propagation -dead-code-elimination"),
+              test.readfile(file));
+    EXPECT_EQ(test.executeBytecode(file), test.readfile(file));
+}
+
+TEST(SSA, gvn)
+{
+    CYXTest test;
+    const std::string file = "ssa/gvn";
+    EXPECT_EQ(test.execute(file, "-ssa -global-value-numbering"), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-ssa -ssa-form minimal -global-value-numbering"), test.readfile(file));
+    EXPECT_EQ(test.execute(file, "-ssa -constant-folding -global-value-numbering -dead-code-elimination"),
+              test.readfile(file));
+    EXPECT_EQ(test.executeBytecode(file), test.readfile(file));
+}
+
 int main(int argc, char *argv[])
 {
     testing::InitGoogleTest(&argc, argv);